@@ -0,0 +1,86 @@
+// EnergyMeter integration and the persist threshold app_energy.cpp uses
+#include "host_check.h"
+#include "energy_meter.h"
+#include "tuya_driver.h"
+
+#define HOUR_MS     3600000LL
+#define WH_MJ       3600000ULL  // 1 Wh in W * ms
+
+static void test_integrates_per_mode() {
+    EnergyMeter meter(2000, 1000, 500);
+    meter.Restore(0, 0);
+    meter.Update(true, MODE_HIGH, 0);
+    CHECK_EQ(meter.Watts(), 2000);
+    CHECK_EQ(meter.EnergyMj(HOUR_MS / 4), 500 * WH_MJ);   // Open segment extrapolated
+
+    meter.Update(true, MODE_ECO, HOUR_MS / 2);
+    CHECK_EQ(meter.EnergyMj(HOUR_MS / 2), 1000 * WH_MJ);
+    meter.Update(false, MODE_ECO, HOUR_MS);
+    CHECK_EQ(meter.Watts(), 0);
+    CHECK_EQ(meter.EnergyMj(HOUR_MS), 1250 * WH_MJ);
+    CHECK_EQ(meter.EnergyMj(2 * HOUR_MS), 1250 * WH_MJ);
+    CHECK_EQ(meter.DutyPermille(2 * HOUR_MS), 500);
+
+    // Powered but not heating, or a mode the heater does not have, draws nothing
+    meter.Update(false, MODE_HIGH, 2 * HOUR_MS);
+    meter.Update(true, 7, 2 * HOUR_MS);
+    CHECK_EQ(meter.Watts(), 0);
+    CHECK_EQ(meter.EnergyMj(3 * HOUR_MS), 1250 * WH_MJ);
+}
+
+// A report that does not change the draw leaves the open segment alone
+static void test_same_draw_keeps_segment() {
+    EnergyMeter meter(1500, 1500, 500);
+    meter.Restore(0, 0);
+    meter.Update(true, MODE_HIGH, 0);
+    meter.Update(true, MODE_LOW, HOUR_MS / 2);
+    meter.Update(true, MODE_LOW, HOUR_MS / 2 + 1);
+    CHECK_EQ(meter.EnergyMj(HOUR_MS), 1500 * WH_MJ);
+    CHECK_EQ(meter.DutyPermille(HOUR_MS), 1000);
+}
+
+// A restored total is continued, duty starts over, and a clock that reads
+// before the segment start adds nothing
+static void test_restore_continues_total() {
+    EnergyMeter meter(2000, 1000, 500);
+    meter.Restore(42 * WH_MJ, 10 * HOUR_MS);
+    CHECK_EQ(meter.EnergyMj(10 * HOUR_MS), 42 * WH_MJ);
+    meter.Update(true, MODE_LOW, 10 * HOUR_MS);
+    CHECK_EQ(meter.EnergyMj(11 * HOUR_MS), 1042 * WH_MJ);
+    CHECK_EQ(meter.EnergyMj(9 * HOUR_MS), 42 * WH_MJ);
+    CHECK_EQ(meter.DutyPermille(11 * HOUR_MS), 1000);
+    CHECK_EQ(meter.DutyPermille(10 * HOUR_MS), 0);
+}
+
+static void test_persist_threshold() {
+    const uint64_t threshold = 50 * WH_MJ;
+    CHECK(!EnergyMeter::PersistDue(100 * WH_MJ, 100 * WH_MJ, threshold, false));
+    CHECK(!EnergyMeter::PersistDue(100 * WH_MJ, 100 * WH_MJ, threshold, true));
+    CHECK(!EnergyMeter::PersistDue(150 * WH_MJ - 1, 100 * WH_MJ, threshold, false));
+    CHECK(EnergyMeter::PersistDue(150 * WH_MJ, 100 * WH_MJ, threshold, false));
+    CHECK(EnergyMeter::PersistDue(100 * WH_MJ + 1, 100 * WH_MJ, threshold, true));
+
+    // Walk a heater at 2 kW through a day: one write per 50 Wh, none lost
+    EnergyMeter meter(2000, 1000, 500);
+    meter.Restore(0, 0);
+    meter.Update(true, MODE_HIGH, 0);
+    uint64_t persisted = 0;
+    int writes = 0;
+    for (int64_t t = 0; t <= 24 * HOUR_MS; t += 1000) {
+        uint64_t energy = meter.EnergyMj(t);
+        if (EnergyMeter::PersistDue(energy, persisted, threshold, false)) {
+            CHECK(energy - persisted < threshold + 2000 * 1000ULL);
+            persisted = energy;
+            writes++;
+        }
+    }
+    CHECK_EQ(writes, 24 * 2000 / 50);
+}
+
+int main() {
+    RUN_TEST(test_integrates_per_mode);
+    RUN_TEST(test_same_draw_keeps_segment);
+    RUN_TEST(test_restore_continues_total);
+    RUN_TEST(test_persist_threshold);
+    return host_check_failures ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+// libFuzzer target for everything that touches received bytes: the frame
+// parser on its own, and TuyaHeaterDriver's RX path (ReadAndParse ->
+// ProcessPacket) fed through a HAL that hands the input out in arbitrary
+// chunk sizes.
+//
+// Input layout: byte 0 = largest chunk (0 -> 1), bytes 1..4 = chunk size
+// seed, rest = the byte stream from the "MCU".
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tuya_stream.h"
+
+#define FUZZ_CHECK(cond) \
+    do { if (!(cond)) abort(); } while (0)
+
+// Serves the stream in chunks of 1..max_chunk bytes; writes are discarded
+class FuzzHal : public TuyaHal {
+public:
+    FuzzHal(const uint8_t *data, size_t len, size_t max_chunk, uint32_t seed)
+        : m_data(data), m_len(len), m_pos(0), m_max_chunk(max_chunk), m_seed(seed), m_now_us(0) {}
+
+    int Read(uint8_t *dst, size_t max_len, uint32_t timeout_ms) override {
+        m_now_us += 1000;
+        if (m_pos == m_len || max_len == 0) return 0;
+        size_t n = 1 + stream_rand(&m_seed) % m_max_chunk;
+        if (n > max_len) n = max_len;
+        if (n > m_len - m_pos) n = m_len - m_pos;
+        memcpy(dst, m_data + m_pos, n);
+        m_pos += n;
+        return (int)n;
+    }
+    int Write(const uint8_t *data, size_t len) override {
+        FUZZ_CHECK(len >= TUYA_FRAME_OVERHEAD && data[0] == TUYA_HEADER_0 && data[1] == TUYA_HEADER_1);
+        return (int)len;
+    }
+    int64_t NowUs() override { return m_now_us += 37; }
+    void DelayMs(uint32_t ms) override { m_now_us += ms * 1000LL; }
+
+    bool Done() const { return m_pos == m_len; }
+
+private:
+    const uint8_t *m_data;
+    size_t m_len;
+    size_t m_pos;
+    size_t m_max_chunk;
+    uint32_t m_seed;
+    int64_t m_now_us;
+};
+
+static void state_cb(const heater_state_t *state, void *ctx) {
+    FUZZ_CHECK(state != nullptr);
+}
+
+// Every frame handed out must be self-consistent, and every byte fed must
+// end up in a frame, dropped, or still pending in the ring
+static void fuzz_parser(const uint8_t *data, size_t len, size_t max_chunk, uint32_t seed) {
+    static TuyaFrameParser parser;
+    parser.Reset();
+    tuya_parser_stats_t before = parser.GetStats();
+
+    size_t pos = 0;
+    uint64_t framed = 0;
+    TuyaFrame frame;
+    while (pos < len) {
+        size_t n = 1 + stream_rand(&seed) % max_chunk;
+        if (n > len - pos) n = len - pos;
+        // A drained parser always has room (see WritePtr)
+        size_t fed = parser.Feed(data + pos, n);
+        FUZZ_CHECK(fed > 0);
+        pos += fed;
+        while (parser.Next(&frame)) {
+            int flen = frame.Length();
+            FUZZ_CHECK(flen >= TUYA_FRAME_OVERHEAD && flen <= TUYA_RX_RING_SIZE);
+            FUZZ_CHECK(frame[0] == TUYA_HEADER_0 && frame[1] == TUYA_HEADER_1);
+            FUZZ_CHECK(frame.PayloadLength() == ((frame[4] << 8) | frame[5]));
+            uint8_t cs = 0;
+            for (int i = 0; i < flen - 1; i++) cs += frame[i];
+            FUZZ_CHECK(cs == frame[flen - 1]);
+            framed += flen;
+        }
+        FUZZ_CHECK(parser.Pending() < TUYA_RX_RING_SIZE);
+    }
+    const tuya_parser_stats_t &after = parser.GetStats();
+    uint64_t dropped = after.bytes_dropped - before.bytes_dropped;
+    FUZZ_CHECK(framed + dropped + parser.Pending() == len);
+}
+
+static void fuzz_driver(const uint8_t *data, size_t len, size_t max_chunk, uint32_t seed) {
+    FuzzHal hal(data, len, max_chunk, seed);
+    TuyaHeaterDriver driver;
+    driver.SetStateCallback(state_cb);
+    driver.Init(&hal);
+    // Interleave writes so the echo matching runs against queued commands
+    driver.SetPowerAndMode(true, MODE_HIGH);
+    driver.SetTemp(21);
+    for (int guard = 0; !hal.Done() && guard < 100000; guard++) {
+        driver.Poll(0);
+    }
+    driver.Poll(0);
+
+    tuya_health_t health;
+    driver.GetHealth(&health);
+    FUZZ_CHECK(health.bytes_in <= len);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 5) return 0;
+    size_t max_chunk = data[0] ? data[0] : 1;
+    uint32_t seed;
+    memcpy(&seed, data + 1, sizeof(seed));
+    data += 5;
+    size -= 5;
+
+    fuzz_parser(data, size, max_chunk, seed);
+    fuzz_driver(data, size, max_chunk, seed);
+    return 0;
+}
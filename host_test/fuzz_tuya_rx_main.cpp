@@ -0,0 +1,157 @@
+// Stand-in for libFuzzer's main when the compiler has no -fsanitize=fuzzer
+// (gcc). Replays the given files, then runs random mutations of a few
+// built-in seeds through the same LLVMFuzzerTestOneInput, so the sanitizer
+// build still exercises the RX path from ctest.
+//
+//   fuzz_tuya_rx_replay [-runs=N] [-seed=S] [--corpus DIR] [FILE...]
+//
+// --corpus writes the seeds to DIR as a starting corpus for the libFuzzer
+// build.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "tuya_stream.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+typedef std::vector<uint8_t> bytes_t;
+
+// 5-byte chunking prefix (see fuzz_tuya_rx.cpp) followed by the stream
+static bytes_t with_prefix(uint8_t max_chunk, uint32_t seed, const uint8_t *stream, size_t len) {
+    bytes_t out = { max_chunk };
+    out.insert(out.end(), (const uint8_t *)&seed, (const uint8_t *)&seed + sizeof(seed));
+    out.insert(out.end(), stream, stream + len);
+    return out;
+}
+
+static std::vector<bytes_t> build_seeds() {
+    std::vector<bytes_t> seeds;
+    uint8_t buf[1024];
+    uint32_t rng = 0x2545F491;
+    uint32_t frames;
+    size_t len;
+
+    len = stream_build(buf, sizeof(buf), false, &frames, &rng);
+    seeds.push_back(with_prefix(64, 1, buf, len));
+    len = stream_build(buf, sizeof(buf), true, &frames, &rng);
+    seeds.push_back(with_prefix(7, 2, buf, len));
+
+    // Boot handshake: heartbeat, product info, status reply
+    const uint8_t hb[] = { 0x01 };
+    const char info[] = "{\"p\":\"hombli\",\"v\":\"1.0.0\",\"m\":0}";
+    len = stream_frame(buf, TUYA_CMD_HEARTBEAT, hb, sizeof(hb));
+    len += stream_frame(buf + len, TUYA_CMD_PRODUCT_INFO, (const uint8_t *)info, strlen(info));
+    len += stream_status_frame(buf + len, 19);
+    seeds.push_back(with_prefix(16, 3, buf, len));
+
+    // Echo of a power write, and a record with an unknown DP and odd type
+    const uint8_t echo[] = { DP_POWER, TUYA_TYPE_BOOL, 0x00, 0x01, 0x00,
+                             0x7F, 0x00, 0x00, 0x03, 0xAA, 0x55, 0x00 };
+    len = stream_frame(buf, TUYA_CMD_STATUS, echo, sizeof(echo));
+    seeds.push_back(with_prefix(3, 4, buf, len));
+
+    // Header announcing the largest payload, then a real frame
+    const uint8_t big[] = { TUYA_HEADER_0, TUYA_HEADER_1, 0x03, TUYA_CMD_STATUS, 0x01, 0xF9 };
+    memcpy(buf, big, sizeof(big));
+    len = sizeof(big) + stream_status_frame(buf + sizeof(big), 21);
+    seeds.push_back(with_prefix(255, 5, buf, len));
+    return seeds;
+}
+
+static void mutate(bytes_t *in, uint32_t *rng) {
+    int edits = 1 + stream_rand(rng) % 8;
+    for (int i = 0; i < edits; i++) {
+        size_t pos = in->empty() ? 0 : stream_rand(rng) % in->size();
+        switch (stream_rand(rng) % 6) {
+        case 0:
+            if (!in->empty()) (*in)[pos] ^= (uint8_t)(1u << (stream_rand(rng) % 8));
+            break;
+        case 1:
+            if (!in->empty()) (*in)[pos] = (uint8_t)stream_rand(rng);
+            break;
+        case 2:
+            in->insert(in->begin() + pos, (uint8_t)stream_rand(rng));
+            break;
+        case 3:
+            if (!in->empty()) in->erase(in->begin() + pos);
+            break;
+        case 4: {
+            const uint8_t hdr[] = { TUYA_HEADER_0, TUYA_HEADER_1 };
+            in->insert(in->begin() + pos, hdr, hdr + sizeof(hdr));
+            break;
+        }
+        default: {
+            // Repeat a slice, e.g. a whole frame
+            size_t n = 1 + stream_rand(rng) % 64;
+            if (n > in->size() - pos) n = in->size() - pos;
+            bytes_t slice(in->begin() + pos, in->begin() + pos + n);
+            in->insert(in->begin() + pos, slice.begin(), slice.end());
+            break;
+        }
+        }
+    }
+    if (in->size() > 4096) in->resize(4096);
+}
+
+static bool read_file(const char *path, bytes_t *out) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    uint8_t buf[4096];
+    size_t n;
+    out->clear();
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out->insert(out->end(), buf, buf + n);
+    fclose(f);
+    return true;
+}
+
+static bool write_corpus(const char *dir, const std::vector<bytes_t> &seeds) {
+    for (size_t i = 0; i < seeds.size(); i++) {
+        std::string path = std::string(dir) + "/seed_" + std::to_string(i);
+        FILE *f = fopen(path.c_str(), "wb");
+        if (!f) return false;
+        fwrite(seeds[i].data(), 1, seeds[i].size(), f);
+        fclose(f);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    long runs = 10000;
+    uint32_t rng = 0x12345678;
+    std::vector<bytes_t> seeds = build_seeds();
+
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "-runs=", 6)) {
+            runs = atol(argv[i] + 6);
+        } else if (!strncmp(argv[i], "-seed=", 6)) {
+            rng = (uint32_t)strtoul(argv[i] + 6, nullptr, 0);
+        } else if (!strcmp(argv[i], "--corpus") && i + 1 < argc) {
+            const char *dir = argv[++i];
+            if (!write_corpus(dir, seeds)) {
+                fprintf(stderr, "cannot write corpus to %s\n", dir);
+                return 2;
+            }
+            printf("wrote %zu seeds to %s\n", seeds.size(), dir);
+            return 0;
+        } else {
+            bytes_t data;
+            if (!read_file(argv[i], &data)) {
+                fprintf(stderr, "cannot read %s\n", argv[i]);
+                return 2;
+            }
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+            printf("replayed %s (%zu bytes)\n", argv[i], data.size());
+        }
+    }
+
+    for (const bytes_t &seed : seeds) LLVMFuzzerTestOneInput(seed.data(), seed.size());
+    for (long i = 0; i < runs; i++) {
+        bytes_t input = seeds[stream_rand(&rng) % seeds.size()];
+        mutate(&input, &rng);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    printf("%ld mutated inputs ok\n", runs);
+    return 0;
+}
@@ -0,0 +1,97 @@
+// HeaterController on a TuyaHeaterDriver talking to the simulated MCU
+#include "host_check.h"
+#include "sim_rig.h"
+#include "heater_control.h"
+
+// An error too small to move the integral in a 1 s step must still add up:
+// 0.5 °C held for half the integral time is worth another 0.25 °C of
+// output, which lifts Eco to Low
+static void test_integral_keeps_remainder() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    HeaterController ctrl(&rig.driver, 0, 600);
+
+    uint32_t now_ms = 1000;
+    ctrl.Update(rig.driver.GetState(), now_ms);
+    ctrl.SetSetpoint(2050); // Room is at 20 °C
+    ctrl.SetEnabled(true);
+    ctrl.Update(rig.driver.GetState(), now_ms);
+    CHECK_EQ(ctrl.GetStage(), HEATER_STAGE_ECO);
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.power && s.mode == MODE_ECO; }, 2000));
+
+    for (int i = 0; i < 280; i++) {
+        now_ms += 1000;
+        ctrl.Update(rig.driver.GetState(), now_ms);
+    }
+    CHECK_EQ(ctrl.GetStage(), HEATER_STAGE_ECO);
+    for (int i = 0; i < 60; i++) {
+        now_ms += 1000;
+        ctrl.Update(rig.driver.GetState(), now_ms);
+    }
+    CHECK_EQ(ctrl.GetStage(), HEATER_STAGE_LOW);
+}
+
+// Written before the MCU answered (Matter up first): not replaced by the
+// heater's own state once it syncs
+static void test_early_write_survives_sync() {
+    SimRig rig;
+    HeaterController ctrl(&rig.driver, 0, 600);
+    ctrl.SetSetpoint(2500);
+    ctrl.SetEnabled(true);
+    rig.after_poll = [&]() { ctrl.Update(rig.driver.GetState(), (uint32_t)(rig.NowUs() / 1000)); };
+    CHECK(rig.Start());
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.power && s.mode == MODE_HIGH; }, 3000));
+    CHECK(ctrl.IsEnabled());
+}
+
+// The MCU comes back from a power cut switched off. That is not someone
+// pressing the button: control stays on and the stage is put back.
+static void test_mcu_restart_keeps_control() {
+    SimRig rig;
+    HeaterController ctrl(&rig.driver, 0, 600);
+    rig.after_poll = [&]() { ctrl.Update(rig.driver.GetState(), (uint32_t)(rig.NowUs() / 1000)); };
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+
+    ctrl.SetSetpoint(2500);
+    ctrl.SetEnabled(true);
+    rig.hal.Wake();
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.power && s.mode == MODE_HIGH; }, 2000));
+
+    rig.sim.Restart();
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return !s.power; }, TUYA_HB_HEALTHY_MS + 3000));
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.power && s.mode == MODE_HIGH; },
+                      HEATER_CTRL_OVERRIDE_MS + 3000));
+    CHECK(ctrl.IsEnabled());
+    CHECK_EQ(ctrl.GetStage(), HEATER_STAGE_HIGH);
+}
+
+// Switching off on the heater itself still hands control back
+static void test_local_power_off_disables() {
+    SimRig rig;
+    HeaterController ctrl(&rig.driver, 0, 600);
+    rig.after_poll = [&]() { ctrl.Update(rig.driver.GetState(), (uint32_t)(rig.NowUs() / 1000)); };
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+
+    ctrl.SetSetpoint(2500);
+    ctrl.SetEnabled(true);
+    rig.hal.Wake();
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.power && s.mode == MODE_HIGH; }, 2000));
+
+    rig.sim.PressPower();
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return !s.power; }, 1000));
+    int64_t deadline = rig.NowUs() + (HEATER_CTRL_OVERRIDE_MS + 3000) * 1000LL;
+    while (ctrl.IsEnabled() && rig.NowUs() < deadline) rig.hal.DelayMs(50);
+    CHECK(!ctrl.IsEnabled());
+    CHECK(!rig.driver.GetState().power);
+}
+
+int main() {
+    RUN_TEST(test_integral_keeps_remainder);
+    RUN_TEST(test_early_write_survives_sync);
+    RUN_TEST(test_mcu_restart_keeps_control);
+    RUN_TEST(test_local_power_off_disables);
+    return host_check_failures ? 1 : 0;
+}
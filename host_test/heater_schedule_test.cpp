@@ -0,0 +1,76 @@
+// WeeklySchedule lookups, and the applied-occurrence bookkeeping that
+// app_schedule.cpp builds on them
+#include "host_check.h"
+#include "heater_schedule.h"
+
+#define MONDAY 0x02
+
+// Fires of the schedule as app_schedule.cpp decides them: an occurrence is
+// the wall-clock minute at which the transition in force last fired
+static int count_fires(const WeeklySchedule &schedule, int64_t start, int64_t minutes) {
+    int fires = 0;
+    int64_t applied = -1;
+    for (int64_t wall = start; wall < start + minutes; wall++) {
+        uint16_t now = (uint16_t)(wall % SCHEDULE_MINUTES_PER_WEEK);
+        int64_t at = wall - WeeklySchedule::MinutesSince(now, schedule.Current(now));
+        if (applied >= 0 && at != applied) fires++;
+        applied = at;
+    }
+    return fires;
+}
+
+static void test_single_entry_fires_weekly() {
+    WeeklySchedule schedule;
+    schedule_transition_t t = { 7 * 60, 2000 };
+    CHECK(schedule.SetDays(MONDAY, &t, 1));
+    CHECK_EQ(schedule.Count(), 1);
+
+    uint16_t at = SCHEDULE_MINUTES_PER_DAY + 7 * 60;
+    CHECK(schedule.Current(0) == schedule.Table());     // Wraps to last week's
+    CHECK_EQ(WeeklySchedule::MinutesSince(at, schedule.Table()), 0);
+    CHECK_EQ(WeeklySchedule::MinutesSince(at - 1, schedule.Table()), SCHEDULE_MINUTES_PER_WEEK - 1);
+    CHECK_EQ(WeeklySchedule::MinutesUntil(at, schedule.Table()), SCHEDULE_MINUTES_PER_WEEK);
+
+    CHECK_EQ(count_fires(schedule, 1000LL * SCHEDULE_MINUTES_PER_WEEK, 3 * SCHEDULE_MINUTES_PER_WEEK), 3);
+}
+
+static void test_workdays_fire_daily() {
+    WeeklySchedule schedule;
+    schedule_transition_t day[] = { { 7 * 60, 2050 }, { 22 * 60 + 30, SCHEDULE_OFF } };
+    CHECK(schedule.SetDays(0x3E, day, 2)); // Monday..Friday
+    CHECK_EQ(schedule.Count(), 10);
+    CHECK_EQ(count_fires(schedule, 1000LL * SCHEDULE_MINUTES_PER_WEEK, 2 * SCHEDULE_MINUTES_PER_WEEK), 20);
+
+    // Friday 22:30 stays in force over the weekend
+    uint16_t saturday_noon = 6 * SCHEDULE_MINUTES_PER_DAY + 12 * 60;
+    CHECK_EQ(schedule.Current(saturday_noon)->setpoint, SCHEDULE_OFF);
+    CHECK_EQ(schedule.Next(saturday_noon)->minute, SCHEDULE_MINUTES_PER_DAY + 7 * 60);
+}
+
+// What GetWeeklySchedule answers: one day's transitions, minute of the day
+static void test_get_day() {
+    WeeklySchedule schedule;
+    schedule_transition_t day[] = { { 0, 1800 }, { 7 * 60, 2050 }, { 23 * 60 + 59, SCHEDULE_OFF } };
+    CHECK(schedule.SetDays(SCHEDULE_SUNDAY | 0x40, day, 3));  // Sunday and Saturday
+    schedule_transition_t t = { 12 * 60, 1900 };
+    CHECK(schedule.SetDays(MONDAY, &t, 1));
+
+    schedule_transition_t out[SCHEDULE_MAX_TRANSITIONS];
+    for (int d = 0; d < SCHEDULE_DAYS; d += 6) {
+        CHECK_EQ(schedule.GetDay(d, out), 3);
+        for (int i = 0; i < 3; i++) {
+            CHECK_EQ(out[i].minute, day[i].minute);
+            CHECK_EQ(out[i].setpoint, day[i].setpoint);
+        }
+    }
+    CHECK_EQ(schedule.GetDay(1, out), 1);
+    CHECK_EQ(out[0].minute, 12 * 60);
+    CHECK_EQ(schedule.GetDay(2, out), 0);
+}
+
+int main() {
+    RUN_TEST(test_single_entry_fires_weekly);
+    RUN_TEST(test_workdays_fire_daily);
+    RUN_TEST(test_get_day);
+    return host_check_failures ? 1 : 0;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdio.h>
+
+// Tiny assertion helpers for the host tests: a failed CHECK is reported and
+// counted, the test binary exits non-zero if any failed.
+static int host_check_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond); \
+            host_check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        long long va_ = (long long)(a), vb_ = (long long)(b); \
+        if (va_ != vb_) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #a, #b, va_, vb_); \
+            host_check_failures++; \
+        } \
+    } while (0)
+
+#define RUN_TEST(fn) \
+    do { \
+        int before_ = host_check_failures; \
+        fn(); \
+        printf("%-40s %s\n", #fn, host_check_failures == before_ ? "ok" : "FAILED"); \
+    } while (0)
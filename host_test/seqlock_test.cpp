@@ -0,0 +1,140 @@
+// SeqLock under contention: one writer, several readers, payloads whose
+// words are all derived from one counter so a torn copy is always visible.
+// The writer never yields, so on a single core readers only run when it is
+// preempted, often in the middle of a Store().
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "host_check.h"
+#include "seqlock.h"
+
+#define SEQLOCK_READERS 4
+#define SEQLOCK_WRITES  200000
+#define SEQLOCK_WORDS   254     // Long stores, so readers get to preempt one
+
+typedef struct {
+    uint32_t seq;
+    uint32_t words[SEQLOCK_WORDS];
+    uint32_t inv;
+} wide_payload_t;
+
+static wide_payload_t wide_make(uint32_t seq) {
+    wide_payload_t p;
+    p.seq = seq;
+    for (uint32_t k = 0; k < SEQLOCK_WORDS; k++) p.words[k] = seq * 2654435761u + k;
+    p.inv = ~seq;
+    return p;
+}
+
+static bool wide_intact(const wide_payload_t &p) {
+    for (uint32_t k = 0; k < SEQLOCK_WORDS; k++) {
+        if (p.words[k] != p.seq * 2654435761u + k) return false;
+    }
+    return p.inv == ~p.seq;
+}
+
+// Not a multiple of the lock's word size
+typedef struct {
+    uint8_t bytes[13];
+} odd_payload_t;
+
+static odd_payload_t odd_make(uint32_t seq) {
+    odd_payload_t p;
+    for (int i = 0; i < 13; i++) p.bytes[i] = (uint8_t)(seq + i);
+    return p;
+}
+
+static bool odd_intact(const odd_payload_t &p) {
+    for (int i = 1; i < 13; i++) {
+        if (p.bytes[i] != (uint8_t)(p.bytes[0] + i)) return false;
+    }
+    return true;
+}
+
+typedef struct {
+    std::atomic<uint32_t> reads { 0 };
+    std::atomic<uint32_t> torn { 0 };
+    std::atomic<uint32_t> backwards { 0 };     // Older value than one already seen
+    std::atomic<uint32_t> out_of_window { 0 }; // Not a value stored during the Load()
+    std::atomic<uint32_t> distinct { 0 };
+} reader_stats_t;
+
+// Store n is published as Sequence() == 2 * (n + 1), so a Load() bracketed
+// by two Sequence() reads must return a store from within that bracket
+static void test_wide_payload() {
+    SeqLock<wide_payload_t> lock;
+    lock.Store(wide_make(0));
+
+    std::atomic<bool> done { false };
+    reader_stats_t stats;
+    std::vector<std::thread> readers;
+    for (int r = 0; r < SEQLOCK_READERS; r++) {
+        readers.emplace_back([&]() {
+            uint32_t last = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                uint32_t before = lock.Sequence();
+                wide_payload_t p = lock.Load();
+                uint32_t after = lock.Sequence();
+                stats.reads++;
+                if (!wide_intact(p)) {
+                    stats.torn++;
+                    continue;
+                }
+                if (p.seq < last) stats.backwards++;
+                if (p.seq != last) stats.distinct++;
+                uint32_t published = 2 * (p.seq + 1);
+                if (published < before || published > after) stats.out_of_window++;
+                last = p.seq;
+            }
+        });
+    }
+
+    for (uint32_t i = 1; i <= SEQLOCK_WRITES; i++) {
+        lock.Store(wide_make(i));
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &t : readers) t.join();
+
+    printf("  %u reads, %u distinct values\n", stats.reads.load(), stats.distinct.load());
+    CHECK(stats.reads > 0);
+    CHECK(stats.distinct > 0);
+    CHECK_EQ(stats.torn, 0);
+    CHECK_EQ(stats.backwards, 0);
+    CHECK_EQ(stats.out_of_window, 0);
+    CHECK_EQ(lock.Load().seq, SEQLOCK_WRITES);
+    CHECK_EQ(lock.Sequence(), 2 * (SEQLOCK_WRITES + 1));
+}
+
+static void test_odd_size_payload() {
+    SeqLock<odd_payload_t> lock;
+    lock.Store(odd_make(0));
+
+    std::atomic<bool> done { false };
+    reader_stats_t stats;
+    std::vector<std::thread> readers;
+    for (int r = 0; r < SEQLOCK_READERS; r++) {
+        readers.emplace_back([&]() {
+            while (!done.load(std::memory_order_acquire)) {
+                odd_payload_t p = lock.Load();
+                stats.reads++;
+                if (!odd_intact(p)) stats.torn++;
+            }
+        });
+    }
+
+    for (uint32_t i = 1; i <= SEQLOCK_WRITES; i++) {
+        lock.Store(odd_make(i));
+    }
+    done.store(true, std::memory_order_release);
+    for (auto &t : readers) t.join();
+
+    CHECK(stats.reads > 0);
+    CHECK_EQ(stats.torn, 0);
+    CHECK_EQ(lock.Load().bytes[0], (uint8_t)SEQLOCK_WRITES);
+}
+
+int main() {
+    RUN_TEST(test_wide_payload);
+    RUN_TEST(test_odd_size_payload);
+    return host_check_failures ? 1 : 0;
+}
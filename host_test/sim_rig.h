@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "tuya_driver.h"
+#include "tuya_hal_posix.h"
+#include "tuya_mcu_sim.h"
+
+// TuyaHeaterDriver on a PosixSerialHal, talking to a TuyaMcuSim through a
+// pty. The driver is polled from its own thread like the RX task on the
+// device; setters are called from the test's thread like the Matter thread.
+class SimRig {
+public:
+    TuyaMcuSim sim;
+    PosixSerialHal hal;
+    TuyaHeaterDriver driver;
+
+    std::atomic<uint32_t> state_changes{0};
+    std::atomic<uint32_t> resets{0};
+
+    // Runs on the poll thread after every Poll(), like heater_after_poll()
+    std::function<void()> after_poll;
+
+    ~SimRig() { Stop(); }
+
+    // Simulator first, so the handshake is answered from the first frame.
+    // setup runs before Init() (coalesce windows and the like).
+    bool Start(std::function<void(TuyaHeaterDriver &)> setup = nullptr) {
+        if (sim.Start() != 0) return false;
+        if (hal.Open(sim.SlavePath()) != 0) return false;
+        driver.SetStateCallback(StateCallback, this);
+        driver.SetResetCallback(ResetCallback, this);
+        if (setup) setup(driver);
+        driver.Init(&hal);
+        m_running = true;
+        m_poll_thread = std::thread([this] {
+            while (m_running) {
+                driver.Poll(50);
+                if (after_poll) after_poll();
+            }
+        });
+        return true;
+    }
+
+    void Stop() {
+        if (!m_poll_thread.joinable()) return;
+        m_running = false;
+        hal.Wake();
+        m_poll_thread.join();
+        hal.Close();
+        sim.Stop();
+    }
+
+    // Waits until a published state satisfies pred; false after timeout_ms
+    bool WaitFor(std::function<bool(const heater_state_t &)> pred, uint32_t timeout_ms) {
+        std::unique_lock<std::mutex> lock(m_lock);
+        return m_cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            return m_has_state && pred(m_state);
+        });
+    }
+
+    bool WaitSynced(uint32_t timeout_ms) {
+        return WaitFor([](const heater_state_t &) { return true; }, timeout_ms);
+    }
+
+    int64_t NowUs() { return hal.NowUs(); }
+
+private:
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+    heater_state_t m_state = {};
+    bool m_has_state = false;
+    std::atomic<bool> m_running{false};
+    std::thread m_poll_thread;
+
+    static void StateCallback(const heater_state_t *state, void *ctx) {
+        SimRig *rig = (SimRig *)ctx;
+        {
+            std::lock_guard<std::mutex> lock(rig->m_lock);
+            rig->m_state = *state;
+            rig->m_has_state = true;
+        }
+        rig->state_changes++;
+        rig->m_cv.notify_all();
+    }
+
+    static void ResetCallback(void *ctx) {
+        ((SimRig *)ctx)->resets++;
+    }
+};
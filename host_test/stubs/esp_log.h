@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdio.h>
+
+// Host build: ESP_LOGx to stderr. Debug and info are compiled in but only
+// printed when HOST_LOG_LEVEL is raised (3 = info, 4 = debug).
+#ifndef HOST_LOG_LEVEL
+#define HOST_LOG_LEVEL 2
+#endif
+
+#define HOST_LOG(level, letter, tag, format, ...) \
+    do { if (HOST_LOG_LEVEL >= level) fprintf(stderr, letter " (%s) " format "\n", tag, ##__VA_ARGS__); } while (0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG(4, "D", tag, format, ##__VA_ARGS__)
@@ -0,0 +1,4 @@
+#pragma once
+
+// Host build: only the options the portable sources look at
+#define CONFIG_HEATER_LATENCY_TRACE 0
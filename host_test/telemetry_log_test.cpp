@@ -0,0 +1,223 @@
+// TelemetryLog: what goes in comes back out of DecodeBlock, block by block
+#include "host_check.h"
+#include "telemetry_log.h"
+#include <string.h>
+#include <vector>
+
+#define PERIOD_S    60
+#define START_TIME  1700000000u
+
+// Offset of the "bytes used" header field, see the layout in telemetry_log.cpp
+#define HDR_USED    5
+
+static uint32_t rng_state = 12345;
+static uint32_t rng() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static telemetry_sample_t sample_at(uint32_t time) {
+    telemetry_sample_t s = {};
+    s.time = time;
+    s.wall_clock = true;
+    s.current_temp = 20;
+    s.target_temp = 21;
+    s.power = true;
+    s.mode = 2;
+    s.duty = 50;
+    return s;
+}
+
+static void collect(const telemetry_sample_t *sample, void *ctx) {
+    ((std::vector<telemetry_sample_t> *)ctx)->push_back(*sample);
+}
+
+// Decodes the whole ring in order and checks the sequence numbers run on
+static std::vector<telemetry_sample_t> decode_all(const TelemetryLog &log) {
+    std::vector<telemetry_sample_t> out;
+    uint8_t block[TELEMETRY_BLOCK_SIZE];
+    for (int i = 0; i < log.BlockCount(); i++) {
+        log.CopyBlock(i, block);
+        uint32_t seq = 0;
+        CHECK(TelemetryLog::BlockSeq(block, &seq));
+        CHECK_EQ(seq, log.OldestSeq() + i);
+        CHECK(TelemetryLog::DecodeBlock(block, collect, &out) > 0);
+    }
+    return out;
+}
+
+static bool same(const telemetry_sample_t &a, const telemetry_sample_t &b) {
+    return a.time == b.time && a.wall_clock == b.wall_clock && a.current_temp == b.current_temp &&
+           a.target_temp == b.target_temp && a.power == b.power && a.mode == b.mode && a.duty == b.duty;
+}
+
+static void check_same(const std::vector<telemetry_sample_t> &got, const std::vector<telemetry_sample_t> &want) {
+    CHECK_EQ(got.size(), want.size());
+    for (size_t i = 0; i < got.size() && i < want.size(); i++) {
+        if (!same(got[i], want[i])) {
+            fprintf(stderr, "sample %zu differs (time %lu vs %lu)\n", i, (unsigned long)got[i].time,
+                    (unsigned long)want[i].time);
+            host_check_failures++;
+            return;
+        }
+    }
+}
+
+// Random walks over every field, including full-range temperature jumps
+// that need two-byte varints
+static void test_round_trip() {
+    static uint8_t storage[64 * TELEMETRY_BLOCK_SIZE];
+    TelemetryLog log(storage, sizeof(storage), PERIOD_S);
+    std::vector<telemetry_sample_t> want;
+
+    telemetry_sample_t s = sample_at(START_TIME);
+    for (int i = 0; i < 2000; i++) {
+        uint32_t r = rng();
+        if ((r & 0x3) == 0) s.current_temp = (int8_t)(s.current_temp + (int)(rng() % 5) - 2);
+        if ((r & 0x1F) == 1) s.current_temp = (int8_t)rng();
+        if ((r & 0x3F) == 2) s.target_temp = (int8_t)(5 + rng() % 31);
+        if ((r & 0x1F) == 3) { s.power = !s.power; s.mode = rng() % 3; }
+        if ((r & 0x7) == 4) s.duty = rng() % 101;
+        log.Append(s);
+        want.push_back(s);
+        s.time += PERIOD_S * (1 + ((r >> 8) % 8 == 0 ? rng() % 300 : 0));
+    }
+    CHECK(log.BlockCount() > 1);
+    CHECK(log.BlockCount() < 64);
+    CHECK_EQ(log.Samples(), 2000);
+    check_same(decode_all(log), want);
+}
+
+// A block takes records until the largest possible one would not fit: with
+// one-byte records that is 100 of them after the keyframe
+static void test_block_full_boundary() {
+    static uint8_t storage[4 * TELEMETRY_BLOCK_SIZE];
+    TelemetryLog log(storage, sizeof(storage), PERIOD_S);
+    std::vector<uint8_t> spilled;
+    log.SetSpill([](const uint8_t *block, void *ctx) {
+        std::vector<uint8_t> *out = (std::vector<uint8_t> *)ctx;
+        out->insert(out->end(), block, block + TELEMETRY_BLOCK_SIZE);
+    }, &spilled);
+
+    for (int i = 0; i < 101; i++) log.Append(sample_at(START_TIME + i * PERIOD_S));
+    CHECK_EQ(log.BlockCount(), 1);
+    CHECK_EQ(log.BytesUsed(), 117);
+    CHECK(spilled.empty());
+
+    log.Append(sample_at(START_TIME + 101 * PERIOD_S));
+    CHECK_EQ(log.BlockCount(), 2);
+    CHECK_EQ(spilled.size(), TELEMETRY_BLOCK_SIZE);
+    if (spilled.size() == TELEMETRY_BLOCK_SIZE) {
+        std::vector<telemetry_sample_t> got;
+        CHECK_EQ(TelemetryLog::DecodeBlock(spilled.data(), collect, &got), 101);
+        CHECK_EQ(got.back().time, START_TIME + 100 * PERIOD_S);
+    }
+
+    // The ring drops its oldest block whole once every slot is taken
+    for (int i = 102; i < 101 * 5; i++) log.Append(sample_at(START_TIME + i * PERIOD_S));
+    CHECK_EQ(log.BlockCount(), 4);
+    CHECK_EQ(log.OldestSeq(), 1);
+    std::vector<telemetry_sample_t> got = decode_all(log);
+    CHECK_EQ(got.size(), 4 * 101);
+    if (!got.empty()) CHECK_EQ(got.front().time, START_TIME + 101 * PERIOD_S);
+}
+
+// Gaps up to MAX_GAP_PERIODS stay in the block as a time delta; longer ones,
+// clock steps back and switches to or from the wall clock start a keyframe
+static void test_gaps_and_clock_steps() {
+    static uint8_t storage[16 * TELEMETRY_BLOCK_SIZE];
+    TelemetryLog log(storage, sizeof(storage), PERIOD_S);
+    std::vector<telemetry_sample_t> want;
+    uint32_t t = START_TIME;
+
+    want.push_back(sample_at(t));
+    want.push_back(sample_at(t += 1000 * PERIOD_S));
+    for (const telemetry_sample_t &s : want) log.Append(s);
+    CHECK_EQ(log.BlockCount(), 1);
+
+    want.push_back(sample_at(t += 1001 * PERIOD_S));
+    log.Append(want.back());
+    CHECK_EQ(log.BlockCount(), 2);
+
+    want.push_back(sample_at(t -= 3600));
+    log.Append(want.back());
+    CHECK_EQ(log.BlockCount(), 3);
+
+    telemetry_sample_t uptime = sample_at(t + PERIOD_S);
+    uptime.wall_clock = false;
+    want.push_back(uptime);
+    log.Append(uptime);
+    CHECK_EQ(log.BlockCount(), 4);
+
+    check_same(decode_all(log), want);
+}
+
+// Sample times off the period grid decode to the grid, without drifting
+static void test_jitter_does_not_drift() {
+    static uint8_t storage[4 * TELEMETRY_BLOCK_SIZE];
+    TelemetryLog log(storage, sizeof(storage), PERIOD_S);
+    for (int i = 0; i < 50; i++) {
+        int jitter = (i % 3 == 0) ? 20 : (i % 3 == 1) ? -20 : 0;
+        log.Append(sample_at(START_TIME + i * PERIOD_S + (i ? jitter : 0)));
+    }
+    std::vector<telemetry_sample_t> got = decode_all(log);
+    CHECK_EQ(got.size(), 50);
+    for (size_t i = 0; i < got.size(); i++) CHECK_EQ(got[i].time, START_TIME + i * PERIOD_S);
+}
+
+static void ignore(const telemetry_sample_t *, void *) {}
+
+static void test_decode_rejects_corrupt_blocks() {
+    static uint8_t storage[TELEMETRY_BLOCK_SIZE];
+    TelemetryLog log(storage, sizeof(storage), PERIOD_S);
+    // One record with a two-byte time varint (300 periods), then one with
+    // only a state byte
+    telemetry_sample_t s = sample_at(START_TIME);
+    log.Append(s);
+    s.time += 300 * PERIOD_S;
+    log.Append(s);
+    s.time += PERIOD_S;
+    s.power = false;
+    log.Append(s);
+
+    uint8_t good[TELEMETRY_BLOCK_SIZE], bad[TELEMETRY_BLOCK_SIZE];
+    log.CopyBlock(0, good);
+    uint16_t used = good[HDR_USED] | (good[HDR_USED + 1] << 8);
+    CHECK_EQ(used, 17 + 3 + 2);
+    CHECK_EQ(TelemetryLog::DecodeBlock(good, ignore, nullptr), 3);
+
+    memcpy(bad, good, sizeof(bad));
+    bad[0] ^= 0xFF;
+    CHECK_EQ(TelemetryLog::DecodeBlock(bad, ignore, nullptr), -1);
+
+    memcpy(bad, good, sizeof(bad));
+    bad[HDR_USED] = TELEMETRY_BLOCK_SIZE + 1;
+    CHECK_EQ(TelemetryLog::DecodeBlock(bad, ignore, nullptr), -1);
+
+    memcpy(bad, good, sizeof(bad));
+    bad[HDR_USED] = 16;
+    CHECK_EQ(TelemetryLog::DecodeBlock(bad, ignore, nullptr), -1);
+
+    memcpy(bad, good, sizeof(bad));
+    bad[HDR_USED] = 17 + 2;     // Ends inside the time varint
+    CHECK_EQ(TelemetryLog::DecodeBlock(bad, ignore, nullptr), -1);
+
+    memcpy(bad, good, sizeof(bad));
+    bad[HDR_USED] = 17 + 3 + 1; // Ends before the state byte
+    CHECK_EQ(TelemetryLog::DecodeBlock(bad, ignore, nullptr), -1);
+
+    memcpy(bad, good, sizeof(bad));
+    bad[17] |= 0x80;            // Unknown control bit
+    CHECK_EQ(TelemetryLog::DecodeBlock(bad, ignore, nullptr), -1);
+}
+
+int main() {
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_block_full_boundary);
+    RUN_TEST(test_gaps_and_clock_steps);
+    RUN_TEST(test_jitter_does_not_drift);
+    RUN_TEST(test_decode_rejects_corrupt_blocks);
+    return host_check_failures ? 1 : 0;
+}
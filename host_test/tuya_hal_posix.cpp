@@ -0,0 +1,157 @@
+#include "tuya_hal_posix.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static speed_t baud_to_speed(int baud) {
+    switch (baud) {
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 115200: return B115200;
+    default:     return B9600;
+    }
+}
+
+PosixSerialHal::PosixSerialHal() : m_stop(false) {
+    m_fd = -1;
+    m_wake_fd[0] = m_wake_fd[1] = -1;
+    m_baud = 0;
+}
+
+PosixSerialHal::~PosixSerialHal() {
+    Close();
+}
+
+int PosixSerialHal::Open(const char *path, int baud) {
+    m_fd = open(path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (m_fd < 0) return -errno;
+
+    struct termios tio;
+    if (tcgetattr(m_fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, baud_to_speed(baud));
+        cfsetospeed(&tio, baud_to_speed(baud));
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(m_fd, TCSANOW, &tio);
+    }
+    if (pipe2(m_wake_fd, O_NONBLOCK | O_CLOEXEC) != 0) {
+        int err = -errno;
+        Close();
+        return err;
+    }
+    m_baud = baud;
+    m_stop = false;
+    m_tx_thread = std::thread(&PosixSerialHal::RunTx, this);
+    return 0;
+}
+
+void PosixSerialHal::Close() {
+    if (m_tx_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_tx_lock);
+            m_stop = true;
+        }
+        m_tx_cv.notify_all();
+        m_tx_thread.join();
+    }
+    for (int i = 0; i < 2; i++) {
+        if (m_wake_fd[i] >= 0) close(m_wake_fd[i]);
+        m_wake_fd[i] = -1;
+    }
+    if (m_fd >= 0) close(m_fd);
+    m_fd = -1;
+}
+
+int PosixSerialHal::Read(uint8_t *dst, size_t max_len, uint32_t timeout_ms) {
+    if (m_fd < 0) return 0;
+    struct pollfd fds[2] = {
+        { m_fd, POLLIN, 0 },
+        { m_wake_fd[0], POLLIN, 0 },
+    };
+    int ready = poll(fds, 2, (int)timeout_ms);
+    if (ready <= 0) return 0;
+
+    if (fds[1].revents & POLLIN) {
+        uint8_t drain[16];
+        while (read(m_wake_fd[0], drain, sizeof(drain)) > 0) {
+        }
+    }
+    if (fds[0].revents & POLLIN) {
+        ssize_t n = read(m_fd, dst, max_len);
+        return n > 0 ? (int)n : 0;
+    }
+    if (fds[0].revents & (POLLHUP | POLLERR)) {
+        // Peer gone (pty master closed): behave like a silent line
+        DelayMs(timeout_ms);
+    }
+    return 0;
+}
+
+int PosixSerialHal::Write(const uint8_t *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(m_fd, data + done, len - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        done += (size_t)n;
+    }
+    return (int)done;
+}
+
+int PosixSerialHal::WriteFrame(const uint8_t *frame, size_t len, tuya_tx_prio_t prio) {
+    if (!m_tx_thread.joinable()) return Write(frame, len);
+    if (!m_tx_queue.Push(frame, len, prio, NowUs())) return -1;
+    {
+        // Orders the push against RunTx()'s predicate check: no lost wake-up
+        std::lock_guard<std::mutex> lock(m_tx_lock);
+    }
+    m_tx_cv.notify_one();
+    return (int)len;
+}
+
+void PosixSerialHal::RunTx() {
+    tuya_tx_frame_t frame;
+    int64_t idle_us = 0;
+    while (1) {
+        {
+            std::unique_lock<std::mutex> lock(m_tx_lock);
+            m_tx_cv.wait(lock, [this] { return m_stop || m_tx_queue.Depth() > 0; });
+            if (m_stop) return;
+        }
+        // Gap before picking the frame, so a more urgent one can still overtake
+        int64_t gap_us = idle_us + POSIX_TX_FRAME_GAP_MS * 1000LL - NowUs();
+        if (gap_us > 0) usleep((useconds_t)gap_us);
+        if (!m_tx_queue.Pop(&frame, NowUs())) continue;
+
+        // The far end has the last byte only after the frame's wire time;
+        // like uart_wait_tx_done(), return once it is off the line
+        usleep((useconds_t)uart_wire_us(frame.len, m_baud));
+        Write(frame.data, frame.len);
+        idle_us = NowUs();
+    }
+}
+
+int64_t PosixSerialHal::NowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void PosixSerialHal::DelayMs(uint32_t ms) {
+    usleep((useconds_t)ms * 1000);
+}
+
+void PosixSerialHal::Wake() {
+    if (m_wake_fd[1] < 0) return;
+    uint8_t b = 1;
+    (void)write(m_wake_fd[1], &b, 1);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "tuya_hal.h"
+#include "tuya_tx_queue.h"
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Minimum idle time between two frames, as on the ESP UART
+#define POSIX_TX_FRAME_GAP_MS 10
+
+// Wire time of len bytes at baud (8N1: 10 bits per byte)
+static inline int64_t uart_wire_us(size_t len, int baud) {
+    return baud > 0 ? (int64_t)len * 10 * 1000000 / baud : 0;
+}
+
+// TuyaHal on a POSIX file descriptor: a real serial port, or the slave side
+// of a pty with TuyaMcuSim on the master. Frames go through the same
+// TuyaTxQueue as on the device, drained by a writer thread that waits out
+// each frame's wire time at `baud`, so a pty behaves like the 9600-baud line.
+class PosixSerialHal : public TuyaHal {
+public:
+    PosixSerialHal();
+    ~PosixSerialHal() override;
+
+    // Opens and configures a tty (raw 8N1 at baud). A pty ignores the baud
+    // rate; the writer thread still paces frames as if it didn't.
+    int Open(const char *path, int baud = 9600);
+    void Close();
+
+    int Read(uint8_t *dst, size_t max_len, uint32_t timeout_ms) override;
+    int Write(const uint8_t *data, size_t len) override;
+    int WriteFrame(const uint8_t *frame, size_t len, tuya_tx_prio_t prio) override;
+    int64_t NowUs() override;
+    void DelayMs(uint32_t ms) override;
+    void Wake() override;
+
+    void GetTxStats(tuya_tx_stats_t *stats) { m_tx_queue.GetStats(stats); }
+
+private:
+    int m_fd;
+    int m_wake_fd[2];       // Pipe that makes a blocked Read() return
+    int m_baud;
+
+    TuyaTxQueue m_tx_queue;
+    std::thread m_tx_thread;
+    std::mutex m_tx_lock;
+    std::condition_variable m_tx_cv;
+    std::atomic<bool> m_stop;
+
+    void RunTx();
+};
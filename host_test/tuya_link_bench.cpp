@@ -0,0 +1,122 @@
+// Write latency, throughput and noise tolerance of TuyaHeaterDriver against
+// the simulated MCU at 9600-baud timing.
+//
+//   tuya_link_bench [--writes N] [--seconds S] [--noise r1,r2,...]
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "sim_rig.h"
+
+static uint32_t percentile(std::vector<uint32_t> v, int pct) {
+    if (v.empty()) return 0;
+    std::sort(v.begin(), v.end());
+    size_t i = (v.size() - 1) * pct / 100;
+    return v[i];
+}
+
+// Setpoint write -> confirmed state, one at a time
+static void bench_latency(int writes) {
+    SimRig rig;
+    if (!rig.Start() || !rig.WaitSynced(2000)) {
+        printf("latency: no sync\n");
+        return;
+    }
+    std::vector<uint32_t> us;
+    for (int i = 0; i < writes; i++) {
+        int temp = 15 + (i % 2);
+        int64_t start = rig.NowUs();
+        rig.driver.SetTemp(temp);
+        if (!rig.WaitFor([temp](const heater_state_t &s) { return s.target_temp == temp; }, 3000)) continue;
+        us.push_back((uint32_t)(rig.NowUs() - start));
+    }
+    // 0x06 out + 0x07 echo (15 B each for a VALUE DP) at 9600 baud, plus the
+    // sim's reply delay
+    uint32_t floor_us = (uint32_t)(uart_wire_us(15 + 15, 9600) + 5000);
+    printf("latency   %3zu/%d writes  p50 %6.1f ms  p95 %6.1f ms  max %6.1f ms  (wire floor %.1f ms)\n",
+           us.size(), writes, percentile(us, 50) / 1000.0, percentile(us, 95) / 1000.0,
+           percentile(us, 100) / 1000.0, floor_us / 1000.0);
+}
+
+// Closed loop: next write as soon as the previous one is confirmed
+static void bench_throughput(int seconds, int dps_per_frame) {
+    SimRig rig;
+    if (!rig.Start() || !rig.WaitSynced(2000)) {
+        printf("throughput: no sync\n");
+        return;
+    }
+    int64_t end = rig.NowUs() + seconds * 1000000LL;
+    int done = 0;
+    for (int i = 0; rig.NowUs() < end; i++) {
+        int temp = 15 + (i % 2);
+        bool screen = (i % 2) != 0;
+        rig.driver.BeginBatch();
+        rig.driver.SetTemp(temp);
+        if (dps_per_frame > 1) rig.driver.SetScreen(screen);
+        rig.driver.CommitBatch();
+        bool ok = rig.WaitFor([&](const heater_state_t &s) {
+            return s.target_temp == temp && (dps_per_frame == 1 || s.screen_on == screen);
+        }, 3000);
+        if (ok) done += dps_per_frame;
+    }
+    tuya_health_t health;
+    rig.driver.GetHealth(&health);
+    printf("throughput %d DP/frame  %6.1f DP writes/s  %5.1f frames/s out  %5.0f B/s in\n",
+           dps_per_frame, done / (double)seconds, health.frames_sent / (double)seconds,
+           health.bytes_in / (double)seconds);
+}
+
+// Fixed number of writes per byte error rate: how many get through, and what
+// it costs in retries and re-queries
+static void bench_noise(double rate, int writes) {
+    SimRig rig;
+    rig.sim.SetNoise(rate, 42);
+    if (!rig.Start() || !rig.WaitSynced(10000)) {
+        printf("noise %.4f: no sync\n", rate);
+        return;
+    }
+    std::vector<uint32_t> us;
+    for (int i = 0; i < writes; i++) {
+        int temp = 15 + (i % 2);
+        int64_t start = rig.NowUs();
+        rig.driver.SetTemp(temp);
+        if (rig.WaitFor([temp](const heater_state_t &s) { return s.target_temp == temp; }, 5000)) {
+            us.push_back((uint32_t)(rig.NowUs() - start));
+        }
+    }
+    tuya_health_t health;
+    rig.driver.GetHealth(&health);
+    tuya_sim_stats_t sim;
+    rig.sim.GetStats(&sim);
+    printf("noise %.4f  %3zu/%d ok  p50 %6.1f ms  p95 %6.1f ms  retries %3lu  timeouts %2lu  bad rx %3lu  bad tx %3lu\n",
+           rate, us.size(), writes, percentile(us, 50) / 1000.0, percentile(us, 95) / 1000.0,
+           (unsigned long)health.retries, (unsigned long)health.timeouts,
+           (unsigned long)health.frames_bad_checksum, (unsigned long)sim.frames_bad);
+}
+
+int main(int argc, char **argv) {
+    int writes = 50;
+    int seconds = 5;
+    std::vector<double> noise = { 0, 0.001, 0.005, 0.01, 0.02 };
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--writes") && i + 1 < argc) {
+            writes = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--noise") && i + 1 < argc) {
+            noise.clear();
+            for (char *tok = strtok(argv[++i], ","); tok; tok = strtok(nullptr, ",")) noise.push_back(atof(tok));
+        } else {
+            fprintf(stderr, "usage: %s [--writes N] [--seconds S] [--noise r1,r2,...]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    bench_latency(writes);
+    bench_throughput(seconds, 1);
+    bench_throughput(seconds, 2);
+    for (double rate : noise) bench_noise(rate, writes);
+    return 0;
+}
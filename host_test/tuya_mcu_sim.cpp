@@ -0,0 +1,318 @@
+#include "tuya_mcu_sim.h"
+#include "tuya_hal_posix.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+static const char *PRODUCT_INFO = "{\"p\":\"hostsim\",\"v\":\"1.0.0\",\"m\":0}";
+
+static int64_t sim_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+TuyaMcuSim::TuyaMcuSim() : m_rng(1), m_stop(false) {
+    m_master_fd = -1;
+    m_slave_path[0] = '\0';
+    m_baud = 9600;
+    m_first_heartbeat = true;
+    m_powered_on_us = 0;
+    m_reply_delay_ms = 5;
+    m_power_on_delay_ms = 0;
+    m_noise = 0;
+    m_silent = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+    ResetDpsLocked();
+}
+
+TuyaMcuSim::~TuyaMcuSim() {
+    Stop();
+}
+
+int TuyaMcuSim::Start(int baud) {
+    m_master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (m_master_fd < 0) return -errno;
+    if (grantpt(m_master_fd) != 0 || unlockpt(m_master_fd) != 0 ||
+        ptsname_r(m_master_fd, m_slave_path, sizeof(m_slave_path)) != 0) {
+        int err = -errno;
+        Stop();
+        return err;
+    }
+
+    // Raw line discipline before anyone talks; a canonical pty would echo and
+    // buffer lines
+    int slave = open(m_slave_path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (slave >= 0) {
+        struct termios tio;
+        if (tcgetattr(slave, &tio) == 0) {
+            cfmakeraw(&tio);
+            tcsetattr(slave, TCSANOW, &tio);
+        }
+        close(slave);
+    }
+
+    m_baud = baud;
+    m_stop = false;
+    m_rx_thread = std::thread(&TuyaMcuSim::RunRx, this);
+    m_tx_thread = std::thread(&TuyaMcuSim::RunTx, this);
+    return 0;
+}
+
+void TuyaMcuSim::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stop = true;
+    }
+    m_tx_cv.notify_all();
+    if (m_rx_thread.joinable()) m_rx_thread.join();
+    if (m_tx_thread.joinable()) m_tx_thread.join();
+    if (m_master_fd >= 0) close(m_master_fd);
+    m_master_fd = -1;
+}
+
+// --- SCRIPT ---
+void TuyaMcuSim::SetReplyDelayMs(uint32_t ms) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_reply_delay_ms = ms;
+}
+
+void TuyaMcuSim::SetPowerOnDelayMs(uint32_t ms) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_power_on_delay_ms = ms;
+}
+
+void TuyaMcuSim::SetNoise(double byte_error_rate, uint32_t seed) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_noise = byte_error_rate;
+    m_rng.seed(seed);
+}
+
+void TuyaMcuSim::SetSilent(bool silent) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_silent = silent;
+    if (silent) m_tx.clear();
+}
+
+void TuyaMcuSim::Restart() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_tx.clear();
+    ResetDpsLocked();
+    m_first_heartbeat = true;
+}
+
+void TuyaMcuSim::SetRunning() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_first_heartbeat = false;
+}
+
+void TuyaMcuSim::PressPower() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    sim_dp_t *power = FindLocked(DP_POWER);
+    power->value = !power->value;
+    QueueReportLocked(*power);
+    if (power->value) {
+        // Wakes up in Eco, whatever it was set to before
+        m_powered_on_us = sim_now_us();
+        sim_dp_t *mode = FindLocked(DP_MODE);
+        mode->value = MODE_ECO;
+        QueueReportLocked(*mode);
+    }
+}
+
+void TuyaMcuSim::SetRoomTemp(int temp) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    sim_dp_t *dp = FindLocked(DP_CUR_TEMP);
+    dp->value = temp;
+    QueueReportLocked(*dp);
+}
+
+int32_t TuyaMcuSim::DpValue(uint8_t dp_id) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    sim_dp_t *dp = FindLocked(dp_id);
+    return dp ? dp->value : -1;
+}
+
+void TuyaMcuSim::GetStats(tuya_sim_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    *stats = m_stats;
+    stats->frames_bad = m_parser.GetStats().frames_bad_checksum;
+}
+
+// --- MCU MODEL ---
+void TuyaMcuSim::ResetDpsLocked() {
+    for (size_t i = 0; i < HeaterSchema::kCount; i++) {
+        const HeaterDpDesc &desc = HeaterSchema::kTable[i];
+        m_dps[i].id = desc.id;
+        m_dps[i].type = desc.type;
+        m_dps[i].len = desc.width;
+        m_dps[i].value = 0;
+    }
+    FindLocked(DP_SET_TEMP)->value = 22;
+    FindLocked(DP_CUR_TEMP)->value = 20;
+    FindLocked(DP_MODE)->value = MODE_ECO;
+}
+
+TuyaMcuSim::sim_dp_t *TuyaMcuSim::FindLocked(uint8_t dp_id) {
+    int index = HeaterSchema::IndexOf(dp_id);
+    return index < 0 ? nullptr : &m_dps[index];
+}
+
+void TuyaMcuSim::QueueFrameLocked(uint8_t command, const uint8_t *payload, int len) {
+    sim_frame_t frame;
+    frame.bytes.reserve(len + TUYA_FRAME_OVERHEAD);
+    frame.bytes.push_back(TUYA_HEADER_0);
+    frame.bytes.push_back(TUYA_HEADER_1);
+    frame.bytes.push_back(0x03); // MCU protocol version
+    frame.bytes.push_back(command);
+    frame.bytes.push_back((len >> 8) & 0xFF);
+    frame.bytes.push_back(len & 0xFF);
+    for (int i = 0; i < len; i++) frame.bytes.push_back(payload[i]);
+    uint8_t cs = 0;
+    for (uint8_t b : frame.bytes) cs += b;
+    frame.bytes.push_back(cs);
+
+    frame.due_us = sim_now_us() + m_reply_delay_ms * 1000LL;
+    m_tx.push_back(std::move(frame));
+    m_tx_cv.notify_one();
+}
+
+void TuyaMcuSim::QueueReportLocked(const sim_dp_t &dp) {
+    uint8_t payload[8];
+    payload[0] = dp.id;
+    payload[1] = dp.type;
+    payload[2] = 0;
+    payload[3] = dp.len;
+    uint32_t raw = (uint32_t)dp.value;
+    for (int i = dp.len - 1; i >= 0; i--) {
+        payload[4 + i] = raw & 0xFF;
+        raw >>= 8;
+    }
+    QueueFrameLocked(TUYA_CMD_STATUS, payload, 4 + dp.len);
+}
+
+void TuyaMcuSim::AddNoiseLocked(uint8_t *data, size_t len) {
+    if (m_noise <= 0) return;
+    std::uniform_real_distribution<double> hit(0.0, 1.0);
+    for (size_t i = 0; i < len; i++) {
+        if (hit(m_rng) >= m_noise) continue;
+        data[i] ^= (uint8_t)(1u << (m_rng() % 8));
+        m_stats.bits_flipped++;
+    }
+}
+
+void TuyaMcuSim::HandleSetDpLocked(const TuyaFrame &frame) {
+    int pos = 6;
+    int end = frame.Length() - 1;
+    while (pos + 4 <= end) {
+        uint8_t dp_id = frame[pos];
+        int len = (frame[pos + 2] << 8) | frame[pos + 3];
+        if (pos + 4 + len > end) break;
+        int32_t value = 0;
+        for (int i = 0; i < len; i++) value = (int32_t)(((uint32_t)value << 8) | frame[pos + 4 + i]);
+        pos += 4 + len;
+
+        sim_dp_t *dp = FindLocked(dp_id);
+        if (!dp || len != dp->len) continue;
+        m_stats.dp_writes++;
+
+        sim_dp_t *power = FindLocked(DP_POWER);
+        if (dp_id == DP_MODE && power->value &&
+            sim_now_us() - m_powered_on_us < m_power_on_delay_ms * 1000LL) {
+            // Still waking up: the write is lost, the echo carries the old mode
+            m_stats.dp_ignored++;
+            QueueReportLocked(*dp);
+            continue;
+        }
+        if (dp_id == DP_SET_TEMP) value = value < 5 ? 5 : (value > 35 ? 35 : value);
+        bool powering_on = dp_id == DP_POWER && value && !dp->value;
+        dp->value = value;
+        QueueReportLocked(*dp);
+
+        if (powering_on) {
+            m_powered_on_us = sim_now_us();
+            sim_dp_t *mode = FindLocked(DP_MODE);
+            mode->value = MODE_ECO;
+            QueueReportLocked(*mode);
+        }
+    }
+}
+
+void TuyaMcuSim::HandleFrameLocked(const TuyaFrame &frame) {
+    m_stats.frames_in++;
+    switch (frame.Command()) {
+    case TUYA_CMD_HEARTBEAT: {
+        m_stats.heartbeats++;
+        uint8_t reply = m_first_heartbeat ? 0x00 : 0x01;
+        m_first_heartbeat = false;
+        QueueFrameLocked(TUYA_CMD_HEARTBEAT, &reply, 1);
+        break;
+    }
+    case TUYA_CMD_PRODUCT_INFO:
+        QueueFrameLocked(TUYA_CMD_PRODUCT_INFO, (const uint8_t *)PRODUCT_INFO, (int)strlen(PRODUCT_INFO));
+        break;
+    case TUYA_CMD_QUERY_STATUS:
+        m_stats.queries++;
+        for (size_t i = 0; i < HeaterSchema::kCount; i++) QueueReportLocked(m_dps[i]);
+        break;
+    case TUYA_CMD_SET_DP:
+        HandleSetDpLocked(frame);
+        break;
+    default:
+        break;
+    }
+}
+
+// --- THREADS ---
+void TuyaMcuSim::RunRx() {
+    uint8_t buf[256];
+    while (!m_stop) {
+        struct pollfd pfd = { m_master_fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 20) <= 0 || !(pfd.revents & POLLIN)) {
+            // No slave open yet (POLLHUP), or just quiet
+            if (pfd.revents & POLLHUP) usleep(5000);
+            continue;
+        }
+        ssize_t n = read(m_master_fd, buf, sizeof(buf));
+        if (n <= 0) continue;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_silent) continue;
+        AddNoiseLocked(buf, (size_t)n);
+        if (m_parser.Feed(buf, (size_t)n) < (size_t)n) m_parser.Reset();
+        TuyaFrame frame;
+        while (m_parser.Next(&frame)) HandleFrameLocked(frame);
+    }
+}
+
+void TuyaMcuSim::RunTx() {
+    std::unique_lock<std::mutex> lock(m_lock);
+    while (!m_stop) {
+        if (m_tx.empty()) {
+            m_tx_cv.wait_for(lock, std::chrono::milliseconds(50));
+            continue;
+        }
+        int64_t wait_us = m_tx.front().due_us - sim_now_us();
+        if (wait_us > 0) {
+            m_tx_cv.wait_for(lock, std::chrono::microseconds(wait_us));
+            continue;
+        }
+        sim_frame_t frame = std::move(m_tx.front());
+        m_tx.pop_front();
+        AddNoiseLocked(frame.bytes.data(), frame.bytes.size());
+        m_stats.frames_out++;
+        m_stats.bytes_out += (uint32_t)frame.bytes.size();
+
+        // The last byte only arrives after the whole frame went over the wire
+        lock.unlock();
+        usleep((useconds_t)uart_wire_us(frame.bytes.size(), m_baud));
+        ssize_t n = write(m_master_fd, frame.bytes.data(), frame.bytes.size());
+        (void)n;
+        lock.lock();
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include "tuya_driver.h"
+#include "tuya_frame_parser.h"
+
+typedef struct {
+    uint32_t frames_in;         // Checksum-valid frames from the ESP side
+    uint32_t frames_bad;        // Damaged frames from the ESP side
+    uint32_t heartbeats;
+    uint32_t queries;           // 0x08
+    uint32_t dp_writes;         // DP records in 0x06 frames
+    uint32_t dp_ignored;        // Mode writes dropped while waking up
+    uint32_t frames_out;
+    uint32_t bytes_out;
+    uint32_t bits_flipped;      // Noise injected, both directions
+} tuya_sim_stats_t;
+
+// Scriptable stand-in for the heater's Tuya MCU on the master side of a pty.
+//
+// Answers heartbeats (0x00, first reply after a restart carries 0x00),
+// product info (0x01), status queries (0x08, one 0x07 per DP) and DP writes
+// (0x06, each DP echoed in its own 0x07). Replies are sent one frame at a
+// time at the wire speed of the configured baud rate, after a configurable
+// processing delay. Like the real heater it wakes up in Eco mode and ignores
+// mode writes for a while after power-on, echoing the old mode instead.
+// Noise flips random bits in both directions. All script calls are
+// thread-safe.
+class TuyaMcuSim {
+public:
+    TuyaMcuSim();
+    ~TuyaMcuSim();
+
+    // Creates the pty pair and starts serving. 0 or -errno.
+    int Start(int baud = 9600);
+    void Stop();
+    // Device the driver side opens (e.g. with PosixSerialHal)
+    const char *SlavePath() const { return m_slave_path; }
+
+    // --- SCRIPT ---
+    void SetReplyDelayMs(uint32_t ms);
+    void SetPowerOnDelayMs(uint32_t ms);
+    // Probability that a byte is hit by a bit flip, per direction
+    void SetNoise(double byte_error_rate, uint32_t seed = 1);
+    // Stop answering altogether (heater unplugged, RX line cut)
+    void SetSilent(bool silent);
+    // MCU reboot: power off, defaults, next heartbeat answered with 0x00
+    void Restart();
+    // MCU that has been up for a while (only the ESP restarted): the first
+    // heartbeat is answered with 0x01
+    void SetRunning();
+    // Physical power button: toggles power and reports it
+    void PressPower();
+    void SetRoomTemp(int temp);
+
+    // Last value the MCU holds for a DP (raw, e.g. DP_SCREEN 0 = on)
+    int32_t DpValue(uint8_t dp_id);
+    void GetStats(tuya_sim_stats_t *stats);
+
+private:
+    typedef struct {
+        uint8_t id;
+        uint8_t type;
+        uint8_t len;
+        int32_t value;
+    } sim_dp_t;
+
+    typedef struct {
+        std::vector<uint8_t> bytes;
+        int64_t due_us;
+    } sim_frame_t;
+
+    int m_master_fd;
+    char m_slave_path[64];
+    int m_baud;
+
+    std::mutex m_lock;          // Everything below, shared by both threads and the script
+    std::condition_variable m_tx_cv;
+    std::deque<sim_frame_t> m_tx;
+    sim_dp_t m_dps[HeaterSchema::kCount];
+    bool m_first_heartbeat;
+    int64_t m_powered_on_us;
+    uint32_t m_reply_delay_ms;
+    uint32_t m_power_on_delay_ms;
+    double m_noise;
+    bool m_silent;
+    std::mt19937 m_rng;
+    tuya_sim_stats_t m_stats;
+
+    TuyaFrameParser m_parser;   // RX thread only
+    std::atomic<bool> m_stop;
+    std::thread m_rx_thread;
+    std::thread m_tx_thread;
+
+    void ResetDpsLocked();
+    sim_dp_t *FindLocked(uint8_t dp_id);
+    void QueueFrameLocked(uint8_t command, const uint8_t *payload, int len);
+    void QueueReportLocked(const sim_dp_t &dp);
+    void AddNoiseLocked(uint8_t *data, size_t len);
+    void HandleFrameLocked(const TuyaFrame &frame);
+    void HandleSetDpLocked(const TuyaFrame &frame);
+    void RunRx();
+    void RunTx();
+};
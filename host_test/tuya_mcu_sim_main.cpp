@@ -0,0 +1,72 @@
+// Standalone simulated heater MCU on a pty, driven by a line script on stdin:
+//
+//   delay <ms>       processing time before each reply
+//   wake <ms>        mode writes ignored this long after power-on
+//   noise <rate>     byte error rate, both directions
+//   silent on|off    stop / resume answering
+//   restart          MCU reboot
+//   button           physical power button
+//   room <temp>      room temperature report
+//   sleep <ms>       pause the script
+//   stats
+//   quit
+//
+// At the end of the script it keeps serving until interrupted.
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "tuya_mcu_sim.h"
+
+static volatile sig_atomic_t s_quit = 0;
+
+static void on_signal(int) {
+    s_quit = 1;
+}
+
+static void print_stats(TuyaMcuSim &sim) {
+    tuya_sim_stats_t s;
+    sim.GetStats(&s);
+    printf("in %lu (bad %lu)  heartbeats %lu  queries %lu  dp writes %lu (ignored %lu)  out %lu frames / %lu B  flips %lu\n",
+           (unsigned long)s.frames_in, (unsigned long)s.frames_bad, (unsigned long)s.heartbeats,
+           (unsigned long)s.queries, (unsigned long)s.dp_writes, (unsigned long)s.dp_ignored,
+           (unsigned long)s.frames_out, (unsigned long)s.bytes_out, (unsigned long)s.bits_flipped);
+    fflush(stdout);
+}
+
+int main() {
+    TuyaMcuSim sim;
+    int err = sim.Start();
+    if (err != 0) {
+        fprintf(stderr, "pty: %s\n", strerror(-err));
+        return 1;
+    }
+    printf("%s\n", sim.SlavePath());
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    char line[128];
+    while (!s_quit && fgets(line, sizeof(line), stdin)) {
+        char cmd[32] = "", arg[32] = "";
+        if (sscanf(line, "%31s %31s", cmd, arg) < 1 || cmd[0] == '#') continue;
+
+        if (!strcmp(cmd, "delay")) sim.SetReplyDelayMs(atoi(arg));
+        else if (!strcmp(cmd, "wake")) sim.SetPowerOnDelayMs(atoi(arg));
+        else if (!strcmp(cmd, "noise")) sim.SetNoise(atof(arg));
+        else if (!strcmp(cmd, "silent")) sim.SetSilent(!strcmp(arg, "on"));
+        else if (!strcmp(cmd, "restart")) sim.Restart();
+        else if (!strcmp(cmd, "button")) sim.PressPower();
+        else if (!strcmp(cmd, "room")) sim.SetRoomTemp(atoi(arg));
+        else if (!strcmp(cmd, "sleep")) usleep((useconds_t)atoi(arg) * 1000);
+        else if (!strcmp(cmd, "stats")) print_stats(sim);
+        else if (!strcmp(cmd, "quit")) s_quit = 1;
+        else fprintf(stderr, "unknown command: %s\n", cmd);
+    }
+    while (!s_quit) pause();
+
+    print_stats(sim);
+    return 0;
+}
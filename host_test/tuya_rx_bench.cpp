@@ -0,0 +1,87 @@
+// Google Benchmark suite for the RX path on the host: the frame parser on the
+// same clean / split / noisy streams as main/app_bench.cpp, and the whole
+// driver (ReadAndParse -> ProcessPacket) on status reports. Build with
+// -DHOST_SANITIZE=OFF -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+#include <benchmark/benchmark.h>
+#include "tuya_stream.h"
+
+#define BENCH_STREAM_SIZE 2048
+#define BENCH_CHUNK_CLEAN 64    // Roughly what one UART idle interrupt delivers
+#define BENCH_CHUNK_SPLIT 7     // 1..7 byte pieces: frames straddle every read
+
+static void bench_parser(benchmark::State &state, bool noisy, bool split) {
+    uint8_t stream[BENCH_STREAM_SIZE];
+    uint32_t rng = 0x2545F491;
+    uint32_t frames_per_pass;
+    size_t len = stream_build(stream, sizeof(stream), noisy, &frames_per_pass, &rng);
+
+    TuyaFrameParser parser;
+    TuyaFrame frame;
+    uint64_t frames = 0;
+    for (auto _ : state) {
+        size_t pos = 0;
+        while (pos < len) {
+            size_t chunk = split ? 1 + stream_rand(&rng) % BENCH_CHUNK_SPLIT : BENCH_CHUNK_CLEAN;
+            if (chunk > len - pos) chunk = len - pos;
+            pos += parser.Feed(&stream[pos], chunk);
+            while (parser.Next(&frame)) frames++;
+        }
+    }
+    if (frames != (uint64_t)frames_per_pass * state.iterations()) state.SkipWithError("frames lost");
+    state.SetBytesProcessed((int64_t)len * state.iterations());
+    state.SetItemsProcessed((int64_t)frames);
+}
+
+static void BM_ParserClean(benchmark::State &state) { bench_parser(state, false, false); }
+static void BM_ParserSplit(benchmark::State &state) { bench_parser(state, false, true); }
+static void BM_ParserNoisy(benchmark::State &state) { bench_parser(state, true, false); }
+BENCHMARK(BM_ParserClean);
+BENCHMARK(BM_ParserSplit);
+BENCHMARK(BM_ParserNoisy);
+
+// One pass of the stream per Poll() in UART-sized reads, then a timeout so
+// Poll() stops draining; writes go nowhere
+class LoopHal : public TuyaHal {
+public:
+    LoopHal(const uint8_t *data, size_t len) : m_data(data), m_len(len), m_pos(0), m_now_us(0) {}
+
+    int Read(uint8_t *dst, size_t max_len, uint32_t timeout_ms) override {
+        if (m_pos == m_len) {
+            m_pos = 0;
+            return 0;
+        }
+        size_t n = BENCH_CHUNK_CLEAN;
+        if (n > max_len) n = max_len;
+        if (n > m_len - m_pos) n = m_len - m_pos;
+        memcpy(dst, m_data + m_pos, n);
+        m_pos += n;
+        return (int)n;
+    }
+    int Write(const uint8_t *data, size_t len) override { return (int)len; }
+    int64_t NowUs() override { return m_now_us += 100; }
+    void DelayMs(uint32_t ms) override { m_now_us += ms * 1000LL; }
+
+private:
+    const uint8_t *m_data;
+    size_t m_len;
+    size_t m_pos;
+    int64_t m_now_us;
+};
+
+static void BM_DriverStatusReports(benchmark::State &state) {
+    uint8_t stream[BENCH_STREAM_SIZE];
+    uint32_t rng = 0x2545F491;
+    uint32_t frames;
+    size_t len = stream_build(stream, sizeof(stream), false, &frames, &rng);
+
+    LoopHal hal(stream, len);
+    TuyaHeaterDriver driver;
+    driver.Init(&hal);
+    for (auto _ : state) driver.Poll(0);
+
+    state.SetBytesProcessed((int64_t)len * state.iterations());
+    state.SetItemsProcessed((int64_t)frames * state.iterations());
+}
+BENCHMARK(BM_DriverStatusReports);
+
+BENCHMARK_MAIN();
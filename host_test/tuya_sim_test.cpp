@@ -0,0 +1,195 @@
+// TuyaHeaterDriver against the simulated MCU over a pty at 9600-baud timing
+#include "host_check.h"
+#include "sim_rig.h"
+
+static void test_boot_sync() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    CHECK(rig.driver.IsSynced());
+    heater_state_t state = rig.driver.GetState();
+    CHECK_EQ(state.target_temp, 22);
+    CHECK_EQ(state.current_temp, 20);
+    CHECK_EQ(state.mode, MODE_ECO);
+    CHECK(!state.power);
+}
+
+static void test_setpoint_echo() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    rig.driver.SetTemp(27);
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.target_temp == 27; }, 1000));
+    CHECK_EQ(rig.sim.DpValue(DP_SET_TEMP), 27);
+    CHECK_EQ(rig.driver.GetCommandStats().timeouts, 0);
+}
+
+static void test_screen_inverted() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    rig.driver.SetScreen(false);
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return !s.screen_on; }, 1000));
+    CHECK_EQ(rig.sim.DpValue(DP_SCREEN), 1); // 1 = off on the wire
+}
+
+static void test_batch_one_frame() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    uint32_t frames_before = rig.driver.GetCommandStats().frames_sent;
+    rig.driver.BeginBatch();
+    rig.driver.SetTemp(18);
+    rig.driver.SetScreen(false);
+    rig.driver.CommitBatch();
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.target_temp == 18 && !s.screen_on; }, 1000));
+    CHECK_EQ(rig.driver.GetCommandStats().frames_sent - frames_before, 1);
+}
+
+// A setpoint quiet window only holds back the setpoint: power written in
+// the same batch goes out at once, and a burst of setpoints costs one frame
+static void test_quiet_window_scope() {
+    SimRig rig;
+    CHECK(rig.Start([](TuyaHeaterDriver &driver) { driver.SetCoalesceWindow(DP_SET_TEMP, 400); }));
+    CHECK(rig.WaitSynced(2000));
+    uint32_t frames_before = rig.driver.GetCommandStats().frames_sent;
+    int64_t start = rig.NowUs();
+    rig.driver.BeginBatch();
+    rig.driver.SetTemp(25);
+    rig.driver.SetPower(true);
+    rig.driver.SetTemp(26);
+    rig.driver.CommitBatch();
+    rig.driver.SetTemp(27);
+
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.power; }, 1000));
+    CHECK(rig.NowUs() - start < 300000);
+    CHECK_EQ(rig.driver.GetState().target_temp, 22);
+
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.target_temp == 27; }, 2000));
+    CHECK(rig.NowUs() - start >= 400000);
+    CHECK_EQ(rig.driver.GetCommandStats().frames_sent - frames_before, 2);
+}
+
+// The heater wakes up in Eco and drops mode writes for a while; the mode
+// must be retried until the MCU really reports High
+static void test_power_on_force_high() {
+    SimRig rig;
+    rig.sim.SetPowerOnDelayMs(300);
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    rig.driver.SetPowerAndMode(true, MODE_HIGH);
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.power && s.mode == MODE_HIGH; }, 3000));
+    CHECK_EQ(rig.sim.DpValue(DP_MODE), MODE_HIGH);
+    tuya_sim_stats_t stats;
+    rig.sim.GetStats(&stats);
+    CHECK(stats.dp_ignored > 0);
+}
+
+// Echoes of our own power writes are not button presses
+static void test_own_power_writes_no_reset() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    for (int i = 0; i < 12; i++) {
+        bool on = (i % 2) == 0;
+        rig.driver.SetPower(on);
+        CHECK(rig.WaitFor([on](const heater_state_t &s) { return s.power == on; }, 1000));
+    }
+    CHECK_EQ(rig.resets, 0);
+}
+
+static void test_button_toggles_reset() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    for (int i = 0; i < 10; i++) {
+        bool on = (i % 2) == 0;
+        rig.sim.PressPower();
+        CHECK(rig.WaitFor([on](const heater_state_t &s) { return s.power == on; }, 1000));
+    }
+    CHECK_EQ(rig.resets, 1);
+}
+
+static void test_mcu_restart_resyncs() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    rig.driver.SetTemp(30);
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.target_temp == 30; }, 1000));
+
+    // Back to defaults; found through the 0x00 heartbeat reply
+    rig.sim.Restart();
+    CHECK(rig.WaitFor([](const heater_state_t &s) { return s.target_temp == 22; }, TUYA_HB_HEALTHY_MS + 3000));
+    CHECK_EQ(rig.driver.GetLinkState(), TUYA_LINK_UP);
+    CHECK_EQ(rig.driver.GetMcuBoot(), TUYA_MCU_BOOT_FRESH);
+}
+
+// 0x00 heartbeat reply: the state is the MCU's power-on default
+static void test_mcu_boot_reported() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    int64_t deadline = rig.NowUs() + 2000 * 1000LL;
+    while (rig.driver.GetMcuBoot() == TUYA_MCU_BOOT_UNKNOWN && rig.NowUs() < deadline) rig.hal.DelayMs(10);
+    CHECK_EQ(rig.driver.GetMcuBoot(), TUYA_MCU_BOOT_FRESH);
+}
+
+// 0x01: only we restarted, the heater's state is current
+static void test_mcu_running_reported() {
+    SimRig rig;
+    rig.sim.SetRunning();
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    int64_t deadline = rig.NowUs() + 2000 * 1000LL;
+    while (rig.driver.GetMcuBoot() == TUYA_MCU_BOOT_UNKNOWN && rig.NowUs() < deadline) rig.hal.DelayMs(10);
+    CHECK_EQ(rig.driver.GetMcuBoot(), TUYA_MCU_BOOT_RUNNING);
+}
+
+static void test_link_down_and_up() {
+    SimRig rig;
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(2000));
+    rig.sim.SetSilent(true);
+    int64_t deadline = rig.NowUs() + (TUYA_HB_HEALTHY_MS + 5000) * 1000LL;
+    while (rig.driver.GetLinkState() != TUYA_LINK_DOWN && rig.NowUs() < deadline) rig.hal.DelayMs(50);
+    CHECK_EQ(rig.driver.GetLinkState(), TUYA_LINK_DOWN);
+
+    rig.sim.SetSilent(false);
+    deadline = rig.NowUs() + 3000 * 1000LL;
+    while (rig.driver.GetLinkState() != TUYA_LINK_UP && rig.NowUs() < deadline) rig.hal.DelayMs(50);
+    CHECK_EQ(rig.driver.GetLinkState(), TUYA_LINK_UP);
+}
+
+static void test_noisy_line_converges() {
+    SimRig rig;
+    rig.sim.SetNoise(0.01, 7);
+    CHECK(rig.Start());
+    CHECK(rig.WaitSynced(5000));
+    // A write can still be lost after all its retries; a controller would
+    // send it again, and so does the test
+    for (int temp = 15; temp < 20; temp++) {
+        bool ok = false;
+        for (int attempt = 0; attempt < 3 && !ok; attempt++) {
+            rig.driver.SetTemp(temp);
+            ok = rig.WaitFor([temp](const heater_state_t &s) { return s.target_temp == temp; }, 5000);
+        }
+        CHECK(ok);
+    }
+}
+
+int main() {
+    RUN_TEST(test_boot_sync);
+    RUN_TEST(test_setpoint_echo);
+    RUN_TEST(test_screen_inverted);
+    RUN_TEST(test_batch_one_frame);
+    RUN_TEST(test_quiet_window_scope);
+    RUN_TEST(test_power_on_force_high);
+    RUN_TEST(test_own_power_writes_no_reset);
+    RUN_TEST(test_button_toggles_reset);
+    RUN_TEST(test_mcu_restart_resyncs);
+    RUN_TEST(test_mcu_boot_reported);
+    RUN_TEST(test_mcu_running_reported);
+    RUN_TEST(test_link_down_and_up);
+    RUN_TEST(test_noisy_line_converges);
+    return host_check_failures ? 1 : 0;
+}
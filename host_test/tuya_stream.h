@@ -0,0 +1,72 @@
+#pragma once
+
+// Synthetic MCU byte streams for the host fuzzer and benchmark. Same shape as
+// main/app_bench.cpp: full 0x07 status reports, optionally with stray bytes
+// (many of them 0x55) between frames.
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "tuya_driver.h"
+#include "tuya_frame_parser.h"
+
+#define STREAM_MAX_NOISE 16
+
+static inline uint32_t stream_rand(uint32_t *state) {
+    // xorshift32: deterministic, so runs are comparable
+    uint32_t x = *state ? *state : 0x9E3779B9;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static inline size_t stream_frame(uint8_t *out, uint8_t cmd, const uint8_t *payload, size_t len) {
+    size_t idx = 0;
+    out[idx++] = TUYA_HEADER_0;
+    out[idx++] = TUYA_HEADER_1;
+    out[idx++] = 0x03;
+    out[idx++] = cmd;
+    out[idx++] = (uint8_t)(len >> 8);
+    out[idx++] = (uint8_t)len;
+    if (len) memcpy(&out[idx], payload, len);
+    idx += len;
+
+    uint8_t cs = 0;
+    for (size_t i = 0; i < idx; i++) cs += out[i];
+    out[idx++] = cs;
+    return idx;
+}
+
+// Full heater status report: power, setpoint, current temp, mode, screen
+static inline size_t stream_status_frame(uint8_t *out, uint8_t temp) {
+    const uint8_t payload[] = {
+        DP_POWER,    TUYA_TYPE_BOOL,  0x00, 0x01, 0x01,
+        DP_SET_TEMP, TUYA_TYPE_VALUE, 0x00, 0x04, 0x00, 0x00, 0x00, 22,
+        DP_CUR_TEMP, TUYA_TYPE_VALUE, 0x00, 0x04, 0x00, 0x00, 0x00, temp,
+        DP_MODE,     TUYA_TYPE_ENUM,  0x00, 0x01, MODE_HIGH,
+        DP_SCREEN,   TUYA_TYPE_BOOL,  0x00, 0x01, 0x00,
+    };
+    return stream_frame(out, TUYA_CMD_STATUS, payload, sizeof(payload));
+}
+
+// Fill up to cap bytes with whole status reports. Returns the length used.
+static inline size_t stream_build(uint8_t *stream, size_t cap, bool noisy, uint32_t *frames, uint32_t *rng) {
+    uint8_t frame[TUYA_FRAME_OVERHEAD + 32];
+    size_t len = 0;
+    *frames = 0;
+    for (;;) {
+        size_t frame_len = stream_status_frame(frame, (uint8_t)(18 + (*frames % 8)));
+        size_t noise = noisy ? stream_rand(rng) % (STREAM_MAX_NOISE + 1) : 0;
+        if (len + noise + frame_len > cap) break;
+
+        for (size_t i = 0; i < noise; i++) {
+            // Stray 0x55s are the expensive case: each one starts a header hunt
+            uint8_t b = (uint8_t)stream_rand(rng);
+            stream[len++] = (b & 0x07) ? b : TUYA_HEADER_0;
+        }
+        memcpy(&stream[len], frame, frame_len);
+        len += frame_len;
+        (*frames)++;
+    }
+    return len;
+}
@@ -0,0 +1,141 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_cpu.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <app_priv.h>
+#include "tuya_frame_parser.h"
+
+// On-device parser benchmark: a synthetic stream of realistic 0x07 status
+// frames is pushed through a private TuyaFrameParser, optionally with line
+// noise between frames or in tiny UART-sized chunks. Besides speed it checks
+// that every byte is accounted for (frame, dropped, or still pending).
+
+#define BENCH_STREAM_SIZE 2048
+#define BENCH_CHUNK_CLEAN 64    // Roughly what one UART idle interrupt delivers
+#define BENCH_CHUNK_SPLIT 7     // 1..7 byte pieces: frames straddle every read
+#define BENCH_MAX_NOISE   16
+
+static uint32_t bench_rand(uint32_t *state)
+{
+    // xorshift32: deterministic, so runs are comparable
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Full heater status report: power, setpoint, current temp, mode, screen
+static int bench_build_frame(uint8_t *out, uint8_t temp)
+{
+    const uint8_t payload[] = {
+        DP_POWER,    TUYA_TYPE_BOOL,  0x00, 0x01, 0x01,
+        DP_SET_TEMP, TUYA_TYPE_VALUE, 0x00, 0x04, 0x00, 0x00, 0x00, 22,
+        DP_CUR_TEMP, TUYA_TYPE_VALUE, 0x00, 0x04, 0x00, 0x00, 0x00, temp,
+        DP_MODE,     TUYA_TYPE_ENUM,  0x00, 0x01, MODE_HIGH,
+        DP_SCREEN,   TUYA_TYPE_BOOL,  0x00, 0x01, 0x00,
+    };
+    int idx = 0;
+    out[idx++] = TUYA_HEADER_0;
+    out[idx++] = TUYA_HEADER_1;
+    out[idx++] = 0x03;
+    out[idx++] = TUYA_CMD_STATUS;
+    out[idx++] = 0x00;
+    out[idx++] = sizeof(payload);
+    memcpy(&out[idx], payload, sizeof(payload));
+    idx += sizeof(payload);
+
+    uint8_t cs = 0;
+    for (int i = 0; i < idx; i++) cs += out[i];
+    out[idx++] = cs;
+    return idx;
+}
+
+static size_t bench_build_stream(uint8_t *stream, app_bench_stream_t kind, uint32_t *frames, uint32_t *rng)
+{
+    uint8_t frame[TUYA_FRAME_OVERHEAD + 32];
+    size_t len = 0;
+    *frames = 0;
+    for (;;) {
+        int frame_len = bench_build_frame(frame, 18 + (*frames % 8));
+        int noise = (kind == APP_BENCH_NOISY) ? (int)(bench_rand(rng) % (BENCH_MAX_NOISE + 1)) : 0;
+        if (len + noise + frame_len > BENCH_STREAM_SIZE) break;
+
+        for (int i = 0; i < noise; i++) {
+            // Stray 0x55s are the expensive case: each one starts a header hunt
+            uint8_t b = (uint8_t)bench_rand(rng);
+            stream[len++] = (b & 0x07) ? b : TUYA_HEADER_0;
+        }
+        memcpy(&stream[len], frame, frame_len);
+        len += frame_len;
+        (*frames)++;
+    }
+    return len;
+}
+
+esp_err_t app_bench_parser(app_bench_stream_t kind, int reps, app_bench_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    if (reps <= 0 || reps > APP_BENCH_MAX_REPS) return ESP_ERR_INVALID_ARG;
+
+    uint8_t *stream = (uint8_t *)malloc(BENCH_STREAM_SIZE);
+    TuyaFrameParser *parser = new (std::nothrow) TuyaFrameParser();
+    if (!stream || !parser) {
+        free(stream);
+        delete parser;
+        return ESP_ERR_NO_MEM;
+    }
+
+    uint32_t rng = 0x2545F491;
+    uint32_t frames_per_pass;
+    size_t stream_len = bench_build_stream(stream, kind, &frames_per_pass, &rng);
+
+    uint32_t frames = 0;
+    uint64_t frame_bytes = 0;
+    uint64_t fed = 0;
+    TuyaFrame frame;
+
+    int64_t start_us = esp_timer_get_time();
+    esp_cpu_cycle_count_t start_cycles = esp_cpu_get_cycle_count();
+    for (int rep = 0; rep < reps; rep++) {
+        size_t pos = 0;
+        while (pos < stream_len) {
+            size_t chunk = (kind == APP_BENCH_SPLIT) ? 1 + bench_rand(&rng) % BENCH_CHUNK_SPLIT : BENCH_CHUNK_CLEAN;
+            if (chunk > stream_len - pos) chunk = stream_len - pos;
+
+            size_t accepted = parser->Feed(&stream[pos], chunk);
+            pos += accepted;
+            fed += accepted;
+            bool progress = accepted > 0;
+            while (parser->Next(&frame)) {
+                frames++;
+                frame_bytes += frame.Length();
+                progress = true;
+            }
+            if (!progress) {
+                result->stalled = true; // Ring full and nothing to drain
+                break;
+            }
+        }
+        if (result->stalled) break;
+    }
+    esp_cpu_cycle_count_t cycles = esp_cpu_get_cycle_count() - start_cycles;
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+
+    const tuya_parser_stats_t &stats = parser->GetStats();
+    result->bytes = fed;
+    result->frames = frames;
+    result->frames_expected = frames_per_pass * (uint32_t)reps;
+    result->elapsed_us = (uint32_t)elapsed_us;
+    result->cycles = cycles;
+    result->bytes_per_sec = elapsed_us > 0 ? (uint32_t)(fed * 1000000 / elapsed_us) : 0;
+    result->cycles_per_frame = frames ? cycles / frames : 0;
+    // Every byte fed must be part of a frame, dropped as noise, or still pending
+    result->accounting_ok = (fed == frame_bytes + stats.bytes_dropped + parser->Pending());
+
+    free(stream);
+    delete parser;
+    return ESP_OK;
+}
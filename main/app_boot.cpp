@@ -0,0 +1,61 @@
+#include <app_priv.h>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <atomic>
+
+static const char *TAG = "APP_BOOT";
+
+// First time each phase was reached, in us since esp_timer start (0 = not yet).
+// 32 bits cover the first 71 minutes, far beyond any boot.
+static std::atomic<uint32_t> s_phase_us[APP_BOOT_PHASE_COUNT];
+
+static const char *const k_phase_names[APP_BOOT_PHASE_COUNT] = {
+    "app_main",
+    "nvs ready",
+    "uart open",
+    "data model",
+    "matter started",
+    "server ready",
+    "ip ready",
+    "mcu synced",
+    "first report",
+};
+
+void app_boot_mark(app_boot_phase_t phase)
+{
+    if (phase >= APP_BOOT_PHASE_COUNT) return;
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    if (now == 0) now = 1;
+    uint32_t expected = 0;
+    if (s_phase_us[phase].compare_exchange_strong(expected, now, std::memory_order_relaxed)) {
+        ESP_LOGI(TAG, "%s at %lu ms", k_phase_names[phase], (unsigned long)(now / 1000));
+    }
+}
+
+uint32_t app_boot_get_us(app_boot_phase_t phase)
+{
+    return (phase < APP_BOOT_PHASE_COUNT) ? s_phase_us[phase].load(std::memory_order_relaxed) : 0;
+}
+
+const char *app_boot_phase_name(app_boot_phase_t phase)
+{
+    return (phase < APP_BOOT_PHASE_COUNT) ? k_phase_names[phase] : "?";
+}
+
+void app_boot_get_overlap(app_boot_overlap_t *out)
+{
+    uint32_t uart = app_boot_get_us(APP_BOOT_UART_OPEN);
+    uint32_t synced = app_boot_get_us(APP_BOOT_MCU_SYNCED);
+    uint32_t nvs = app_boot_get_us(APP_BOOT_NVS_READY);
+    uint32_t started = app_boot_get_us(APP_BOOT_MATTER_STARTED);
+
+    *out = {};
+    if (uart && synced >= uart) out->handshake_ms = (synced - uart) / 1000;
+    if (nvs && started >= nvs) out->bringup_ms = (started - nvs) / 1000;
+    if (!out->handshake_ms || !out->bringup_ms) return;
+
+    // Time both ran at once; run back to back the boot would take this much longer
+    uint32_t begin = uart > nvs ? uart : nvs;
+    uint32_t end = synced < started ? synced : started;
+    out->overlap_ms = end > begin ? (end - begin) / 1000 : 0;
+}
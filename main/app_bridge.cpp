@@ -0,0 +1,249 @@
+#include <app_priv.h>
+#include <esp_log.h>
+
+#if CONFIG_HEATER_BRIDGE
+#include <stdio.h>
+#include <string.h>
+#include <app/reporting/reporting.h>
+#include <platform/CHIPDeviceLayer.h>
+#include "seqlock.h"
+#include <atomic>
+
+using namespace chip::app::Clusters;
+using namespace esp_matter;
+
+static const char *TAG = "APP_BRIDGE";
+
+// One heater behind the bridge: its own UART and driver, and the same
+// mailbox hand-over to the Matter thread as the main heater
+struct BridgedHeater {
+    BridgedHeater(int uart_num, int tx_pin, int rx_pin) : uart((uart_port_t)uart_num), tx_pin(tx_pin), rx_pin(rx_pin) {}
+
+    EspUartHal uart;
+    TuyaHeaterDriver driver;
+    int tx_pin;
+    int rx_pin;
+    uint16_t endpoint_id = 0;
+
+    SeqLock<heater_state_t> mailbox;
+    SeqLock<app_local_temp_t> local_temp;
+    std::atomic<bool> update_scheduled{false};
+    std::atomic<bool> link_ok{false};
+    // UART open and polled by the RX task. If not, the endpoint stays
+    // unreachable with a null LocalTemperature and writes are refused.
+    std::atomic<bool> online{false};
+
+    // Last state pushed to Matter; only touched on the Matter thread
+    heater_state_t published;
+    bool has_published = false;
+    bool reachable = true;
+};
+
+// Heater 1 is the main one (app_driver); these are heaters 2..
+static BridgedHeater s_heaters[] = {
+    { CONFIG_HEATER_2_UART_NUM, CONFIG_HEATER_2_TX_PIN, CONFIG_HEATER_2_RX_PIN },
+#if CONFIG_HEATER_BRIDGE_COUNT >= 2
+    { CONFIG_HEATER_3_UART_NUM, CONFIG_HEATER_3_TX_PIN, CONFIG_HEATER_3_RX_PIN },
+#endif
+};
+#define BRIDGED_COUNT (int)(sizeof(s_heaters) / sizeof(s_heaters[0]))
+
+// Set once esp_matter::start() returned; work can't be scheduled before that
+static std::atomic<bool> s_matter_ready(false);
+
+static BridgedHeater *find_heater(uint16_t endpoint_id)
+{
+    for (int i = 0; i < BRIDGED_COUNT; i++) {
+        if (s_heaters[i].endpoint_id != 0 && s_heaters[i].endpoint_id == endpoint_id) return &s_heaters[i];
+    }
+    return nullptr;
+}
+
+// --- MATTER THREAD ---
+static void BridgeUpdateTask(intptr_t context)
+{
+    BridgedHeater *h = (BridgedHeater *)context;
+    h->update_scheduled.store(false, std::memory_order_release);
+    bool link_ok = h->link_ok.load();
+
+    if (link_ok != h->reachable) {
+        h->reachable = link_ok;
+        esp_matter_attr_val_t reachable_val = esp_matter_bool(link_ok);
+        attribute::report(h->endpoint_id, BridgedDeviceBasicInformation::Id,
+                          BridgedDeviceBasicInformation::Attributes::Reachable::Id, &reachable_val);
+    }
+
+    // Nothing from the MCU yet: only reachability can have changed
+    if (h->mailbox.Sequence() != 0) {
+        heater_state_t state = h->mailbox.Load();
+        // Same reporting as the main heater; no local control, no screen
+        uint32_t changed = STATE_FIELD_ALL;
+        if (h->has_published) {
+            changed = app_heater_changed_fields(h->published, state, false);
+            if (state.power != h->published.power) changed |= STATE_FIELD_SYSTEM_MODE;
+        }
+        app_heater_report_thermostat(h->endpoint_id, state, state.power, false, changed);
+        h->published = state;
+        h->has_published = true;
+    }
+
+    // Raw MCU reading; the EMA filter is kept for the main heater
+    app_local_temp_t prev = h->local_temp.Load();
+    app_local_temp_t temp = { prev.value, h->has_published && link_ok };
+    if (h->has_published) temp.value = (int16_t)(h->published.current_temp * 100);
+    if (temp.value != prev.value || temp.valid != prev.valid) {
+        h->local_temp.Store(temp);
+        MatterReportingAttributeChangeCallback(h->endpoint_id, Thermostat::Id, Thermostat::Attributes::LocalTemperature::Id);
+    }
+}
+
+static void ScheduleBridgeUpdate(BridgedHeater *h)
+{
+    if (!s_matter_ready.load()) return; // app_bridge_start() publishes everything
+    if (!h->update_scheduled.exchange(true, std::memory_order_acq_rel)) {
+        if (chip::DeviceLayer::PlatformMgr().ScheduleWork(BridgeUpdateTask, (intptr_t)h) != CHIP_NO_ERROR) {
+            h->update_scheduled.store(false, std::memory_order_release);
+        }
+    }
+}
+
+// --- RX TASK ---
+static void bridged_state_callback(const heater_state_t *state, void *ctx)
+{
+    BridgedHeater *h = (BridgedHeater *)ctx;
+    h->mailbox.Store(*state);
+    ScheduleBridgeUpdate(h);
+}
+
+static void bridged_link_callback(tuya_link_state_t state, void *ctx)
+{
+    BridgedHeater *h = (BridgedHeater *)ctx;
+    bool ok = (state == TUYA_LINK_UP || state == TUYA_LINK_DEGRADED);
+    if (h->link_ok.exchange(ok) != ok) ScheduleBridgeUpdate(h);
+}
+
+void app_bridge_open(TuyaPollGroup *group)
+{
+    for (int i = 0; i < BRIDGED_COUNT; i++) {
+        BridgedHeater &h = s_heaters[i];
+        esp_err_t err = h.uart.Open(h.tx_pin, h.rx_pin, TUYA_RX_EVENT_DRIVEN);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Heater %d: UART%d open failed: %s", i + 2, (int)h.uart.Port(), esp_err_to_name(err));
+            continue;
+        }
+#if CONFIG_HEATER_LOW_POWER
+        if (h.uart.EnableSleepWakeup(CONFIG_HEATER_UART_WAKEUP_THRESHOLD) != ESP_OK) {
+            ESP_LOGW(TAG, "Heater %d: UART wakeup unavailable", i + 2);
+        }
+#endif
+        h.driver.SetCoalesceWindow(DP_SET_TEMP, HEATER_SETPOINT_QUIET_MS);
+        h.driver.SetStateCallback(bridged_state_callback, &h);
+        h.driver.SetLinkCallback(bridged_link_callback, &h);
+        // No reset callback: the power-button factory reset is the main heater's
+        h.driver.Init(&h.uart);
+
+        if (group->Add(&h.driver, &h.uart) != ESP_OK) {
+            ESP_LOGE(TAG, "Heater %d: no room in the RX task", i + 2);
+            continue;
+        }
+        h.online.store(true);
+    }
+}
+
+// --- DATA MODEL ---
+esp_err_t app_bridge_create_endpoints(node_t *node)
+{
+    endpoint::aggregator::config_t aggregator_config;
+    endpoint_t *aggregator_ep = endpoint::aggregator::create(node, &aggregator_config, ENDPOINT_FLAG_NONE, NULL);
+    if (!aggregator_ep) {
+        ESP_LOGE(TAG, "Failed to create aggregator endpoint");
+        return ESP_FAIL;
+    }
+
+    for (int i = 0; i < BRIDGED_COUNT; i++) {
+        BridgedHeater &h = s_heaters[i];
+        endpoint::thermostat::config_t thermostat_config = {};
+        thermostat_config.thermostat.feature_flags = cluster::thermostat::feature::heating::get_id();
+        endpoint_t *endpoint = endpoint::thermostat::create(node, &thermostat_config, ENDPOINT_FLAG_BRIDGE, &h);
+        if (!endpoint) {
+            ESP_LOGE(TAG, "Failed to create endpoint for heater %d", i + 2);
+            return ESP_FAIL;
+        }
+        endpoint::bridged_node::config_t bridged_config;
+        esp_err_t err = endpoint::bridged_node::add(endpoint, &bridged_config);
+        if (err != ESP_OK) return err;
+        err = endpoint::set_parent_endpoint(endpoint, aggregator_ep);
+        if (err != ESP_OK) return err;
+        h.endpoint_id = endpoint::get_id(endpoint);
+
+        cluster_t *cluster = cluster::get(endpoint, Thermostat::Id);
+        if (cluster && !attribute::get(cluster, Thermostat::Attributes::ThermostatRunningState::Id)) {
+            attribute::create(cluster, Thermostat::Attributes::ThermostatRunningState::Id, ATTRIBUTE_FLAG_NULLABLE, esp_matter_bitmap16(0));
+        }
+        esp_matter_attr_val_t seq_val = esp_matter_enum8(2); // Heating only
+        attribute::update(h.endpoint_id, Thermostat::Id, Thermostat::Attributes::ControlSequenceOfOperation::Id, &seq_val);
+
+        cluster_t *info = cluster::get(endpoint, BridgedDeviceBasicInformation::Id);
+        if (info) {
+            char label[16];
+            snprintf(label, sizeof(label), "Heater %d", i + 2);
+            cluster::bridged_device_basic_information::attribute::create_node_label(info, label, strlen(label));
+        }
+
+        app_local_temp_t unknown = { 2000, false };
+        h.local_temp.Store(unknown);
+        ESP_LOGI(TAG, "Heater %d: UART%d, endpoint %u", i + 2, (int)h.uart.Port(), h.endpoint_id);
+    }
+    return ESP_OK;
+}
+
+void app_bridge_start()
+{
+    s_matter_ready.store(true);
+    // Handshakes that finished during bring-up, and every Reachable verdict so far
+    for (int i = 0; i < BRIDGED_COUNT; i++) ScheduleBridgeUpdate(&s_heaters[i]);
+}
+
+bool app_bridge_attribute_update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id,
+                                 esp_matter_attr_val_t *val, esp_err_t *err)
+{
+    BridgedHeater *h = find_heater(endpoint_id);
+    if (!h) return false;
+    *err = ESP_OK;
+    if (cluster_id != Thermostat::Id) return true;
+    if (!h->online.load()) {
+        // Nothing would ever send it; fail the write instead of queueing it
+        *err = ESP_ERR_INVALID_STATE;
+        return true;
+    }
+
+    if (attribute_id == Thermostat::Attributes::SystemMode::Id) {
+        if (val->val.u8 == (uint8_t)Thermostat::SystemModeEnum::kOff) {
+            h->driver.SetPower(false);
+        } else {
+            h->driver.SetPowerAndMode(true, MODE_HIGH);
+        }
+    } else if (attribute_id == Thermostat::Attributes::OccupiedHeatingSetpoint::Id) {
+        h->driver.SetTemp(val->val.i16 / 100);
+    }
+    return true;
+}
+
+bool app_bridge_get_local_temp(uint16_t endpoint_id, app_local_temp_t *temp)
+{
+    BridgedHeater *h = find_heater(endpoint_id);
+    if (!h) return false;
+    *temp = h->local_temp.Load();
+    return true;
+}
+
+#else
+
+esp_err_t app_bridge_create_endpoints(esp_matter::node_t *node) { return ESP_OK; }
+void app_bridge_open(TuyaPollGroup *group) {}
+void app_bridge_start() {}
+bool app_bridge_attribute_update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id,
+                                 esp_matter_attr_val_t *val, esp_err_t *err) { return false; }
+bool app_bridge_get_local_temp(uint16_t endpoint_id, app_local_temp_t *temp) { return false; }
+
+#endif // CONFIG_HEATER_BRIDGE
@@ -0,0 +1,416 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_matter.h>
+#include <esp_matter_console.h>
+#include <app_priv.h>
+#include "latency_trace.h"
+
+#if CONFIG_ENABLE_CHIP_SHELL
+
+using namespace esp_matter::console;
+
+static engine heater_console;
+
+static const char *link_state_name(tuya_link_state_t state)
+{
+    switch (state) {
+    case TUYA_LINK_UNKNOWN:  return "unknown";
+    case TUYA_LINK_UP:       return "up";
+    case TUYA_LINK_DEGRADED: return "degraded";
+    case TUYA_LINK_DOWN:     return "down";
+    case TUYA_LINK_RESYNC:   return "resync";
+    }
+    return "?";
+}
+
+static esp_err_t heater_health_handler(int argc, char **argv)
+{
+    tuya_health_t health;
+    app_driver_get_health(&health);
+
+    printf("link:              %s\n", link_state_name(app_driver_get_link_state()));
+    printf("bytes in/out:      %lu / %lu\n", (unsigned long)health.bytes_in, (unsigned long)health.bytes_out);
+    printf("frames ok:         %lu\n", (unsigned long)health.frames_ok);
+    printf("frames bad csum:   %lu\n", (unsigned long)health.frames_bad_checksum);
+    printf("resync bytes:      %lu\n", (unsigned long)health.resync_bytes);
+    printf("overflows:         %lu\n", (unsigned long)health.overflows);
+    printf("unknown DPs:       %lu (+%lu malformed)\n", (unsigned long)health.unknown_dps, (unsigned long)health.bad_dps);
+    printf("unknown commands:  %lu\n", (unsigned long)health.unknown_commands);
+    printf("frames sent:       %lu\n", (unsigned long)health.frames_sent);
+    printf("commands sent:     %lu (retries %lu, timeouts %lu)\n", (unsigned long)health.commands_sent,
+           (unsigned long)health.retries, (unsigned long)health.timeouts);
+
+    uint32_t sent, suppressed;
+    app_driver_get_report_stats(&sent, &suppressed);
+    printf("matter reports:    %lu sent, %lu suppressed\n", (unsigned long)sent, (unsigned long)suppressed);
+
+    uint32_t commits, skipped;
+    app_state_cache_get_stats(&commits, &skipped);
+    printf("state commits:     %lu written, %lu unchanged\n", (unsigned long)commits, (unsigned long)skipped);
+    return ESP_OK;
+}
+
+// Shared RX task: compare runs with different heater counts to see how
+// CPU time and the delay one port adds to another scale
+static esp_err_t heater_rx_handler(int argc, char **argv)
+{
+    if (argc >= 1 && strcmp(argv[0], "reset") == 0) {
+        app_driver_reset_rx_stats();
+        printf("rx stats reset\n");
+        return ESP_OK;
+    }
+
+    tuya_poll_group_stats_t stats = app_driver_get_rx_stats();
+    uint64_t window_us = esp_timer_get_time() - stats.since_us;
+    uint32_t busy_milli = window_us ? (uint32_t)(stats.busy_us * 100000 / window_us) : 0; // 0.001 %
+    uint32_t per_wakeup = stats.wakeups ? (uint32_t)(stats.busy_us / stats.wakeups) : 0;
+    printf("window:            %lu s, %lu wake-ups\n", (unsigned long)(window_us / 1000000), (unsigned long)stats.wakeups);
+    printf("busy:              %lu.%03lu %% (avg %lu us per wake-up, longest pass %lu us)\n",
+           (unsigned long)(busy_milli / 1000), (unsigned long)(busy_milli % 1000), (unsigned long)per_wakeup,
+           (unsigned long)stats.max_pass_us);
+
+    printf("%-6s %-5s %-9s %8s %7s %7s\n", "heater", "uart", "link", "polls", "avg us", "max us");
+    for (int i = 0; i < stats.members; i++) {
+        const tuya_poll_member_stats_t &m = stats.member[i];
+        uint32_t avg = m.polls ? (uint32_t)(m.busy_us / m.polls) : 0;
+        printf("%-6d %-5d %-9s %8lu %7lu %7lu\n", i + 1, m.port, link_state_name(m.link), (unsigned long)m.polls,
+               (unsigned long)avg, (unsigned long)m.max_us);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t heater_tx_handler(int argc, char **argv)
+{
+    static const char *prio_names[TUYA_TX_PRIO_COUNT] = { "command", "query", "heartbeat" };
+    tuya_tx_stats_t stats;
+    for (int heater = 0; app_driver_get_tx_stats(heater, &stats); heater++) {
+        printf("heater %d:          depth %d (max %d of %d)\n", heater + 1, stats.depth, stats.max_depth, TUYA_TX_QUEUE_LEN);
+        printf("  %-10s %7s %7s %7s %7s %8s %8s\n", "priority", "queued", "sent", "merged", "dropped", "avg us", "max us");
+        for (int p = 0; p < TUYA_TX_PRIO_COUNT; p++) {
+            const tuya_tx_class_stats_t &c = stats.prio[p];
+            uint32_t avg = c.sent ? (uint32_t)(c.wait_total_us / c.sent) : 0;
+            printf("  %-10s %7lu %7lu %7lu %7lu %8lu %8lu\n", prio_names[p], (unsigned long)c.queued, (unsigned long)c.sent,
+                   (unsigned long)c.coalesced, (unsigned long)c.dropped, (unsigned long)avg, (unsigned long)c.wait_max_us);
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t heater_power_handler(int argc, char **argv)
+{
+    app_power_stats_t stats;
+    app_power_get_stats(&stats);
+    printf("last period:       %lu wake-ups, %lu of %lu ms asleep\n", (unsigned long)stats.wakeups,
+           (unsigned long)stats.asleep_ms, (unsigned long)stats.period_ms);
+    printf("since boot:        %lu wake-ups, %lu ms asleep\n", (unsigned long)stats.total_wakeups,
+           (unsigned long)stats.total_asleep_ms);
+    return ESP_OK;
+}
+
+static esp_err_t heater_energy_handler(int argc, char **argv)
+{
+    app_energy_stats_t stats;
+    app_energy_get_stats(&stats);
+    printf("active power:      %u W\n", stats.watts);
+    printf("energy imported:   %lu Wh (%lu Wh in flash, %lu writes since boot)\n", (unsigned long)stats.energy_wh,
+           (unsigned long)stats.persisted_wh, (unsigned long)stats.persist_count);
+    printf("heating duty:      %lu.%lu %% since boot\n", (unsigned long)(stats.duty_permille / 10),
+           (unsigned long)(stats.duty_permille % 10));
+    return ESP_OK;
+}
+
+#if CONFIG_HEATER_TELEMETRY
+static void print_sample(const telemetry_sample_t *sample, void *ctx)
+{
+    (*(uint32_t *)ctx)++;
+    printf("%lu,%c,%d,%d,%d,%u,%u\n", (unsigned long)sample->time, sample->wall_clock ? 'w' : 'u', sample->current_temp,
+           sample->target_temp, sample->power, sample->mode, sample->duty);
+}
+
+static esp_err_t heater_history_handler(int argc, char **argv)
+{
+    bool all = (argc >= 1 && strcmp(argv[0], "all") == 0);
+    if (argc >= 1 && strcmp(argv[0], "stats") == 0) {
+        app_telemetry_stats_t stats;
+        app_telemetry_get_stats(&stats);
+        printf("samples:           %lu since boot\n", (unsigned long)stats.samples);
+        printf("ram:               %u of %u bytes\n", (unsigned)stats.bytes_used, (unsigned)stats.capacity);
+        printf("flash:             %lu blocks, %lu written since boot\n", (unsigned long)stats.flash_blocks,
+               (unsigned long)stats.flash_written);
+        return ESP_OK;
+    }
+
+    // time: unix seconds (w) or seconds since boot (u)
+    uint32_t count = 0;
+    printf("time,clock,current,target,power,mode,duty\n");
+    app_telemetry_export(all, print_sample, &count);
+    printf("# %lu samples\n", (unsigned long)count);
+    return ESP_OK;
+}
+#endif
+
+static esp_err_t heater_bench_handler(int argc, char **argv)
+{
+    int reps = (argc >= 1) ? atoi(argv[0]) : 100;
+    static const char *names[] = { "clean", "noisy", "split" };
+
+    printf("%-6s %9s %11s %9s %9s %s\n", "stream", "frames", "bytes/s", "cyc/frame", "us", "check");
+    for (int kind = APP_BENCH_CLEAN; kind <= APP_BENCH_SPLIT; kind++) {
+        app_bench_result_t r;
+        esp_err_t err = app_bench_parser((app_bench_stream_t)kind, reps, &r);
+        if (err != ESP_OK) {
+            printf("%-6s failed: %s (reps 1..%d)\n", names[kind], esp_err_to_name(err), APP_BENCH_MAX_REPS);
+            return err;
+        }
+        printf("%-6s %4lu/%-4lu %11lu %9lu %9lu %s\n", names[kind], (unsigned long)r.frames,
+               (unsigned long)r.frames_expected, (unsigned long)r.bytes_per_sec, (unsigned long)r.cycles_per_frame,
+               (unsigned long)r.elapsed_us, r.stalled ? "STALLED" : (r.accounting_ok ? "ok" : "BYTES LOST"));
+    }
+    return ESP_OK;
+}
+
+static esp_err_t heater_boot_handler(int argc, char **argv)
+{
+    printf("%-16s %9s %9s\n", "phase", "at ms", "+ms");
+    uint32_t prev = 0;
+    for (int i = 0; i < APP_BOOT_PHASE_COUNT; i++) {
+        uint32_t at = app_boot_get_us((app_boot_phase_t)i);
+        if (!at) {
+            printf("%-16s %9s\n", app_boot_phase_name((app_boot_phase_t)i), "-");
+            continue;
+        }
+        // Phases from different tasks can land out of order
+        printf("%-16s %9lu %9ld\n", app_boot_phase_name((app_boot_phase_t)i), (unsigned long)(at / 1000),
+               prev ? (long)((int32_t)(at - prev) / 1000) : 0L);
+        prev = at;
+    }
+
+    app_boot_overlap_t o;
+    app_boot_get_overlap(&o);
+    printf("mcu handshake %lu ms, matter bring-up %lu ms, %lu ms run concurrently\n",
+           (unsigned long)o.handshake_ms, (unsigned long)o.bringup_ms, (unsigned long)o.overlap_ms);
+    return ESP_OK;
+}
+
+#if CONFIG_HEATER_SCHEDULE
+static const char *const k_day_names[SCHEDULE_DAYS] = { "sun", "mon", "tue", "wed", "thu", "fri", "sat" };
+
+static int day_index(const char *name, size_t len)
+{
+    for (int d = 0; d < SCHEDULE_DAYS; d++) {
+        if (len == 3 && strncmp(name, k_day_names[d], 3) == 0) return d;
+    }
+    return -1;
+}
+
+// "all", "mon", "mon-fri", "sat,sun", "fri-mon" -> day bitmap (bit 0 = Sunday)
+static bool parse_days(const char *arg, uint8_t *days)
+{
+    *days = 0;
+    if (strcmp(arg, "all") == 0) {
+        *days = SCHEDULE_ALL_DAYS;
+        return true;
+    }
+    while (*arg) {
+        const char *end = strchr(arg, ',');
+        size_t len = end ? (size_t)(end - arg) : strlen(arg);
+        const char *dash = (const char *)memchr(arg, '-', len);
+        int first = day_index(arg, dash ? (size_t)(dash - arg) : len);
+        int last = dash ? day_index(dash + 1, len - (dash - arg) - 1) : first;
+        if (first < 0 || last < 0) return false;
+        for (int d = first;; d = (d + 1) % SCHEDULE_DAYS) {
+            *days |= 1 << d;
+            if (d == last) break;
+        }
+        arg += len + (end ? 1 : 0);
+    }
+    return *days != 0;
+}
+
+// "07:00=20.5" or "22:30=off"
+static bool parse_transition(const char *arg, schedule_transition_t *t)
+{
+    int hour, minute, used = 0;
+    if (sscanf(arg, "%d:%d=%n", &hour, &minute, &used) != 2 || used == 0) return false;
+    if (hour < 0 || hour > 23 || minute < 0 || minute > 59) return false;
+    t->minute = (uint16_t)(hour * 60 + minute);
+
+    const char *value = arg + used;
+    if (strcmp(value, "off") == 0) {
+        t->setpoint = SCHEDULE_OFF;
+        return true;
+    }
+    char *end;
+    float celsius = strtof(value, &end);
+    if (end == value || *end || celsius < 5.0f || celsius > 35.0f) return false;
+    t->setpoint = (int16_t)(celsius * 100.0f + 0.5f);
+    return true;
+}
+
+static void print_minute(uint16_t minute)
+{
+    printf("%s %02d:%02d", k_day_names[minute / SCHEDULE_MINUTES_PER_DAY],
+           (minute % SCHEDULE_MINUTES_PER_DAY) / 60, minute % 60);
+}
+
+static esp_err_t heater_schedule_handler(int argc, char **argv)
+{
+    if (argc >= 2 && strcmp(argv[0], "set") == 0) {
+        uint8_t days;
+        schedule_transition_t day[SCHEDULE_MAX_TRANSITIONS];
+        int count = argc - 2;
+        if (!parse_days(argv[1], &days) || count > SCHEDULE_MAX_TRANSITIONS) return ESP_ERR_INVALID_ARG;
+        for (int i = 0; i < count; i++) {
+            if (!parse_transition(argv[i + 2], &day[i])) {
+                printf("bad transition '%s' (HH:MM=<5..35>|off)\n", argv[i + 2]);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+        return app_schedule_set_days(days, day, count);
+    }
+    if (argc >= 1 && strcmp(argv[0], "clear") == 0) {
+        uint8_t days = SCHEDULE_ALL_DAYS;
+        if (argc >= 2 && !parse_days(argv[1], &days)) return ESP_ERR_INVALID_ARG;
+        return app_schedule_clear(days);
+    }
+    if (argc >= 2 && strcmp(argv[0], "clock") == 0) {
+        return app_schedule_set_clock(strtoll(argv[1], NULL, 10));
+    }
+    if (argc >= 1) return ESP_ERR_INVALID_ARG;
+
+    // Too big for the console task's stack
+    static app_schedule_info_t info;
+    app_schedule_get(&info);
+    if (info.clock_valid) {
+        printf("local time:  ");
+        print_minute(info.now);
+        printf(":%02d\n", info.second);
+    } else {
+        printf("local time:  not set\n");
+    }
+    printf("applied:     %lu since boot\n", (unsigned long)info.applied);
+    for (int i = 0; i < info.count; i++) {
+        print_minute(info.table[i].minute);
+        if (info.table[i].setpoint == SCHEDULE_OFF) printf("  off");
+        else printf("  %d.%02d", info.table[i].setpoint / 100, info.table[i].setpoint % 100);
+        printf("%s\n", i == info.next ? "  <- next" : "");
+    }
+    return ESP_OK;
+}
+#endif
+
+#if CONFIG_HEATER_LATENCY_TRACE
+static esp_err_t heater_latency_handler(int argc, char **argv)
+{
+    if (argc >= 1 && strcmp(argv[0], "reset") == 0) {
+        latency_trace_reset();
+        return ESP_OK;
+    }
+
+    printf("%-20s %7s %9s %9s %9s\n", "stage", "count", "p50 ms", "p95 ms", "max ms");
+    for (int i = 0; i < LATENCY_SEGMENT_COUNT; i++) {
+        latency_summary_t s;
+        latency_trace_get(i, &s);
+        printf("%-20s %7lu %5lu.%03lu %5lu.%03lu %5lu.%03lu\n", latency_trace_segment_name(i), (unsigned long)s.count,
+               (unsigned long)(s.p50_us / 1000), (unsigned long)(s.p50_us % 1000),
+               (unsigned long)(s.p95_us / 1000), (unsigned long)(s.p95_us % 1000),
+               (unsigned long)(s.max_us / 1000), (unsigned long)(s.max_us % 1000));
+    }
+    return ESP_OK;
+}
+#endif
+
+static esp_err_t print_description(const command_t *command, void *arg)
+{
+    printf("\t%s: %s\n", command->name, command->description);
+    return ESP_OK;
+}
+
+static esp_err_t heater_dispatch(int argc, char **argv)
+{
+    if (argc <= 0) {
+        heater_console.for_each_command(print_description, NULL);
+        return ESP_OK;
+    }
+    return heater_console.exec_command(argc, argv);
+}
+
+void app_console_register_commands()
+{
+    static const command_t heater_commands[] = {
+        {
+            .name = "health",
+            .description = "Tuya protocol counters. Usage: matter esp heater health",
+            .handler = heater_health_handler,
+        },
+        {
+            .name = "rx",
+            .description = "Shared RX task load and per-heater poll cost. Usage: matter esp heater rx [reset]",
+            .handler = heater_rx_handler,
+        },
+        {
+            .name = "tx",
+            .description = "UART transmit queue depth and wait per priority. Usage: matter esp heater tx",
+            .handler = heater_tx_handler,
+        },
+        {
+            .name = "power",
+            .description = "Light-sleep wake-ups and time asleep. Usage: matter esp heater power",
+            .handler = heater_power_handler,
+        },
+        {
+            .name = "energy",
+            .description = "Estimated power, energy and heating duty cycle. Usage: matter esp heater energy",
+            .handler = heater_energy_handler,
+        },
+#if CONFIG_HEATER_TELEMETRY
+        {
+            .name = "history",
+            .description = "Temperature/power/duty history as CSV. Usage: matter esp heater history [all|stats]",
+            .handler = heater_history_handler,
+        },
+#endif
+        {
+            .name = "bench",
+            .description = "Frame parser throughput on clean, noisy and split streams. Usage: matter esp heater bench [reps]",
+            .handler = heater_bench_handler,
+        },
+        {
+            .name = "boot",
+            .description = "Startup phase timestamps and handshake/bring-up overlap. Usage: matter esp heater boot",
+            .handler = heater_boot_handler,
+        },
+#if CONFIG_HEATER_SCHEDULE
+        {
+            .name = "schedule",
+            .description = "Weekly schedule. Usage: matter esp heater schedule [set <days> HH:MM=<temp|off>... | "
+                           "clear [days] | clock <unix-seconds>], days like mon-fri or sat,sun",
+            .handler = heater_schedule_handler,
+        },
+#endif
+#if CONFIG_HEATER_LATENCY_TRACE
+        {
+            .name = "latency",
+            .description = "Write -> MCU -> report latency per stage. Usage: matter esp heater latency [reset]",
+            .handler = heater_latency_handler,
+        },
+#endif
+    };
+    heater_console.register_commands(heater_commands, sizeof(heater_commands) / sizeof(heater_commands[0]));
+
+    static const command_t command = {
+        .name = "heater",
+        .description = "Heater diagnostics. Usage: matter esp heater <command>",
+        .handler = heater_dispatch,
+    };
+    add_commands(&command, 1);
+}
+
+#else
+
+void app_console_register_commands() {}
+
+#endif // CONFIG_ENABLE_CHIP_SHELL
@@ -1,4 +1,5 @@
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <stdlib.h>
 #include <string.h>
 #include <esp_matter.h>
@@ -11,6 +12,13 @@
 #include <app/server/CommissioningWindowManager.h>
 
 #include "tuya_driver.h"
+#include "tuya_hal_esp.h"
+#include "tuya_poll_group.h"
+#include "seqlock.h"
+#include "latency_trace.h"
+#include "temp_filter.h"
+#include "heater_control.h"
+#include <atomic>
 
 using namespace chip::app::Clusters;
 using namespace chip::app::Clusters::Thermostat;
@@ -19,81 +27,384 @@ using namespace esp_matter;
 static const char *TAG = "app_driver";
 extern uint16_t thermostat_endpoint_id;
 extern uint16_t screen_endpoint_id;
+static EspUartHal heater_uart((uart_port_t)CONFIG_HEATER_UART_NUM);
 static TuyaHeaterDriver heater;
 
-// Global Temp for AAI
-int16_t g_current_temp_int = 2000; 
+// LocalTemperature for the AAI (served as null while not valid). Written on
+// the Matter thread only; readers get value + validity as one snapshot.
+static SeqLock<app_local_temp_t> s_local_temp;
+static app_local_temp_t s_local_temp_shadow = { 2000, false };
 
 #define BUTTON_GPIO_PIN 23
 
+// Upper bound for one blocking wait of the RX task; shortened whenever a
+// driver has a heartbeat, retry or handshake step due
+#define POLL_IDLE_TIMEOUT_MS 60000
+
+#if CONFIG_HEATER_LOCAL_CONTROL
+static HeaterController s_controller(&heater, CONFIG_HEATER_CONTROL_MIN_DWELL_S * 1000, CONFIG_HEATER_CONTROL_INTEGRAL_S);
+static constexpr bool k_local_control = true;
+#else
+static constexpr bool k_local_control = false;
+#endif
+
+static void ScheduleStateUpdate();
+static void RestoreAfterPowerCut();
+static void OpenHeaterBatch();
+
 // --- POLL TASK ---
+static void tuya_state_change_callback(const heater_state_t *state, void *ctx);
+static void tuya_reset_callback(void *ctx);
+static void tuya_link_callback(tuya_link_state_t state, void *ctx);
+
+// One task blocks on the UARTs of every heater (this one and the bridged ones)
+static TuyaPollGroup s_poll_group;
+
+// After every poll of the main heater
+static void heater_after_poll(void *ctx)
+{
+#if CONFIG_HEATER_LOCAL_CONTROL
+    // Right after every MCU report; heartbeats keep it ticking otherwise
+    bool was_enabled = s_controller.IsEnabled();
+    s_controller.Update(heater.GetState(), (uint32_t)(esp_timer_get_time() / 1000));
+    if (s_controller.IsEnabled() != was_enabled) ScheduleStateUpdate(); // SystemMode follows
+#endif
+    RestoreAfterPowerCut();
+}
+
+// Owns the UARTs and the drivers from the start, so the MCU handshakes run
+// concurrently with the Matter bring-up in app_main
 static void tuya_poll_task(void *pvParameters)
 {
-    ESP_LOGI(TAG, "Tuya Poll Task Started");
-    while (1) {
-        heater.Poll(); 
-        
-        static int ticks = 0;
-        if (ticks++ > 200) { 
-            heater.SendHeartbeat();
-            ticks = 0;
-        }
-        vTaskDelay(pdMS_TO_TICKS(50));
+    esp_err_t err = heater_uart.Open(TUYA_TX_PIN, TUYA_RX_PIN, TUYA_RX_EVENT_DRIVEN);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "UART open failed: %s", esp_err_to_name(err));
+    }
+#if CONFIG_HEATER_LOW_POWER
+    if (heater_uart.EnableSleepWakeup(CONFIG_HEATER_UART_WAKEUP_THRESHOLD) != ESP_OK) {
+        ESP_LOGW(TAG, "UART wakeup unavailable, MCU frames may be missed while asleep");
     }
+#endif
+    heater.SetCoalesceWindow(DP_SET_TEMP, HEATER_SETPOINT_QUIET_MS);
+    heater.SetStateCallback(tuya_state_change_callback);
+    // Register the Reset Callback
+    heater.SetResetCallback(tuya_reset_callback);
+    heater.SetLinkCallback(tuya_link_callback);
+    app_boot_mark(APP_BOOT_UART_OPEN);
+    heater.Init(&heater_uart);
+
+    s_poll_group.Add(&heater, &heater_uart, heater_after_poll, nullptr);
+    app_bridge_open(&s_poll_group);
+
+    ESP_LOGI(TAG, "Tuya Poll Task Started (%s RX, %d heater(s))", heater_uart.IsEventDriven() ? "event-driven" : "polled",
+             s_poll_group.Count());
+    // Fully blocked until a frame arrives or a driver has work due
+    s_poll_group.Run(POLL_IDLE_TIMEOUT_MS);
+}
+
+tuya_poll_group_stats_t app_driver_get_rx_stats()
+{
+    return s_poll_group.GetStats();
+}
+
+void app_driver_reset_rx_stats()
+{
+    s_poll_group.ResetStats();
+}
+
+bool app_driver_get_tx_stats(int heater, tuya_tx_stats_t *stats)
+{
+    return s_poll_group.GetTxStats(heater, stats);
 }
 
 // --- THREAD BRIDGE ---
-struct AppEventData {
-    heater_state_t state;
-};
+// Single-slot "latest state" mailbox: the poll task overwrites it, the Matter
+// thread drains it. No heap, and at most one AppDriverUpdateTask is queued, so
+// a burst of 0x07 reports collapses into one update with the newest state.
+static SeqLock<heater_state_t> s_state_mailbox;
+static std::atomic<bool> s_update_scheduled(false);
 
-static void AppDriverUpdateTask(intptr_t context)
+// Last state pushed to Matter; only touched on the Matter thread
+static heater_state_t s_published_state;
+static bool s_published_heat = false;
+static bool s_has_published = false;
+static uint32_t s_reports_sent = 0;
+static uint32_t s_reports_suppressed = 0;
+
+// --- THERMOSTAT REPORTING ---
+// Shared with the bridged heaters (app_bridge.cpp), which never have local control
+uint16_t app_heater_running_state(const heater_state_t &state, bool local_control)
+{
+    if (!state.power) return 0; // Idle
+    // The controller idles by switching the element off, so power is the
+    // truth; otherwise the heater's own thermostat stops 1 °C over target
+    if (local_control || state.current_temp < state.target_temp + 1) return 1; // Heating
+    return 0;
+}
+
+uint32_t app_heater_changed_fields(const heater_state_t &prev, const heater_state_t &next, bool local_control)
+{
+    uint32_t changed = 0;
+    if (prev.current_temp != next.current_temp) changed |= STATE_FIELD_LOCAL_TEMP;
+    if (prev.target_temp != next.target_temp) changed |= STATE_FIELD_SETPOINT;
+    if (app_heater_running_state(prev, local_control) != app_heater_running_state(next, local_control)) {
+        changed |= STATE_FIELD_RUNNING_STATE;
+    }
+    if (prev.screen_on != next.screen_on) changed |= STATE_FIELD_SCREEN;
+    return changed;
+}
+
+void app_heater_report_thermostat(uint16_t endpoint_id, const heater_state_t &state, bool heat, bool local_control,
+                                  uint32_t changed)
 {
-    AppEventData *data = (AppEventData *)context;
-    if (!data) return;
+    if (changed & STATE_FIELD_SETPOINT) {
+        esp_matter_attr_val_t target_val = esp_matter_int16(state.target_temp * 100);
+        esp_matter::attribute::report(endpoint_id, Thermostat::Id, Thermostat::Attributes::OccupiedHeatingSetpoint::Id, &target_val);
+    }
+    if (changed & STATE_FIELD_SYSTEM_MODE) {
+        uint8_t matter_mode = (uint8_t)(heat ? Thermostat::SystemModeEnum::kHeat : Thermostat::SystemModeEnum::kOff);
+        esp_matter_attr_val_t mode_val = esp_matter_enum8(matter_mode);
+        esp_matter::attribute::report(endpoint_id, Thermostat::Id, Thermostat::Attributes::SystemMode::Id, &mode_val);
+    }
+    if (changed & STATE_FIELD_RUNNING_STATE) {
+        esp_matter_attr_val_t run_val = esp_matter_bitmap16(app_heater_running_state(state, local_control));
+        esp_matter::attribute::report(endpoint_id, Thermostat::Id, Thermostat::Attributes::ThermostatRunningState::Id, &run_val);
+    }
+}
 
-    g_current_temp_int = data->state.current_temp * 100;
-    MatterReportingAttributeChangeCallback(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::LocalTemperature::Id);
+static uint16_t heater_running_state(const heater_state_t &state)
+{
+    return app_heater_running_state(state, k_local_control);
+}
 
-    esp_matter_attr_val_t target_val = esp_matter_int16(data->state.target_temp * 100);
-    esp_matter::attribute::report(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::OccupiedHeatingSetpoint::Id, &target_val);
+// SystemMode Heat: the heater is on, or (local control) being regulated
+static bool heater_system_heat(const heater_state_t &state)
+{
+#if CONFIG_HEATER_LOCAL_CONTROL
+    return s_controller.IsEnabled();
+#else
+    return state.power;
+#endif
+}
 
-    uint8_t matter_mode = (uint8_t)Thermostat::SystemModeEnum::kOff;
-    if (data->state.power) matter_mode = (uint8_t)Thermostat::SystemModeEnum::kHeat;
-    
-    esp_matter_attr_val_t mode_val = esp_matter_enum8(matter_mode);
-    esp_matter::attribute::report(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::SystemMode::Id, &mode_val);
+// --- LINK STATE ---
+// LocalTemperature is served as null until the first synced report and
+// whenever the MCU link is down or the MCU is re-syncing after a reset
+static std::atomic<bool> s_link_ok(false);
+// No verdict on the link yet: a state restored from flash may be served
+static std::atomic<bool> s_link_pending(true);
+// Set once esp_matter::start() returned; work can't be scheduled before that
+static std::atomic<bool> s_matter_ready(false);
 
-    uint16_t running_state = 0; // Idle
-    if (data->state.power) {
-        if (data->state.current_temp < (data->state.target_temp + 1)) {
-            running_state = 1; // Heating
-        }
+static void RefreshLocalTempValidity()
+{
+    bool valid = s_has_published && (s_link_ok.load() || s_link_pending.load());
+    if (s_local_temp_shadow.valid != valid) {
+        s_local_temp_shadow.valid = valid;
+        s_local_temp.Store(s_local_temp_shadow);
+        ESP_LOGI(TAG, "LocalTemperature %s", valid ? "valid" : "unavailable (null)");
+        MatterReportingAttributeChangeCallback(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::LocalTemperature::Id);
+    }
+}
+
+app_local_temp_t app_driver_get_local_temp()
+{
+    return s_local_temp.Load();
+}
+
+static void AppLinkUpdateTask(intptr_t context)
+{
+    RefreshLocalTempValidity();
+}
+
+static void tuya_link_callback(tuya_link_state_t state, void *ctx)
+{
+    bool ok = (state == TUYA_LINK_UP || state == TUYA_LINK_DEGRADED);
+    bool was_pending = s_link_pending.exchange(false);
+    if ((s_link_ok.exchange(ok) != ok || was_pending) && s_matter_ready.load()) {
+        chip::DeviceLayer::PlatformMgr().ScheduleWork(AppLinkUpdateTask, 0);
+    }
+}
+
+// --- LOCAL TEMPERATURE FILTER ---
+// Matter thread only. The tick timer runs while the EMA is still moving.
+#define TEMP_FILTER_TICK_MS (CONFIG_HEATER_TEMP_FILTER_TICK_S * 1000)
+
+static TempFilter s_temp_filter(CONFIG_HEATER_TEMP_FILTER_SHIFT, CONFIG_HEATER_TEMP_HYSTERESIS,
+                                CONFIG_HEATER_TEMP_MIN_REPORT_S * 1000);
+static bool s_temp_tick_armed = false;
+
+static void StepTempFilter()
+{
+    int16_t value;
+    if (!s_temp_filter.Step((uint32_t)(esp_timer_get_time() / 1000), &value)) return;
+
+    s_local_temp_shadow.value = value;
+    s_local_temp.Store(s_local_temp_shadow);
+    if (s_local_temp_shadow.valid) {
+        s_reports_sent++;
+        MatterReportingAttributeChangeCallback(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::LocalTemperature::Id);
     }
-    esp_matter_attr_val_t run_val = esp_matter_bitmap16(running_state);
-    esp_matter::attribute::report(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::ThermostatRunningState::Id, &run_val);
+}
+
+static void ArmTempFilterTick();
+
+static void TempFilterTick(chip::System::Layer *layer, void *context)
+{
+    s_temp_tick_armed = false;
+    StepTempFilter();
+    ArmTempFilterTick();
+}
+
+static void ArmTempFilterTick()
+{
+    if (s_temp_tick_armed || s_temp_filter.Idle()) return;
+    if (chip::DeviceLayer::SystemLayer().StartTimer(chip::System::Clock::Milliseconds32(TEMP_FILTER_TICK_MS),
+                                                    TempFilterTick, nullptr) == CHIP_NO_ERROR) {
+        s_temp_tick_armed = true;
+    }
+}
+
+static void AppDriverUpdateTask(intptr_t context)
+{
+    // Clear first: a report landing after this point schedules a fresh run
+    s_update_scheduled.store(false, std::memory_order_release);
+    heater_state_t state = s_state_mailbox.Load();
+
+    // Only touch attributes whose value actually moved since the last publish
+    uint32_t changed = s_has_published ? app_heater_changed_fields(s_published_state, state, k_local_control) : STATE_FIELD_ALL;
+    bool heat = heater_system_heat(state);
+    if (heat != s_published_heat) changed |= STATE_FIELD_SYSTEM_MODE;
+    s_published_state = state;
+    s_published_heat = heat;
+    s_has_published = true;
+    app_boot_mark(APP_BOOT_FIRST_REPORT);
+
+    // LocalTemperature is reported by the filter (StepTempFilter), not here
+    const uint32_t direct_fields = STATE_FIELD_ALL & ~STATE_FIELD_LOCAL_TEMP;
+    int reported = __builtin_popcount(changed & direct_fields);
+    s_reports_sent += reported;
+    s_reports_suppressed += __builtin_popcount(direct_fields) - reported;
+    if (changed & STATE_FIELD_LOCAL_TEMP) {
+        bool first = !s_temp_filter.HasValue();
+        s_temp_filter.Sample(state.current_temp * 100);
+        if (first) StepTempFilter(); // Publish the first reading right away
+        ArmTempFilterTick();
+    }
+    RefreshLocalTempValidity();
+    if (!changed) return;
 
+    app_heater_report_thermostat(thermostat_endpoint_id, state, heat, k_local_control, changed);
+    int64_t now_us = esp_timer_get_time();
+    if (changed & STATE_FIELD_SETPOINT) latency_trace_mark(DP_SET_TEMP, LATENCY_STAGE_REPORT, now_us);
+    if (changed & STATE_FIELD_SYSTEM_MODE) latency_trace_mark(DP_POWER, LATENCY_STAGE_REPORT, now_us);
 
-    if (screen_endpoint_id != 0) {
-        esp_matter_attr_val_t screen_val = esp_matter_bool(data->state.screen_on);
+    if ((changed & STATE_FIELD_SCREEN) && screen_endpoint_id != 0) {
+        esp_matter_attr_val_t screen_val = esp_matter_bool(state.screen_on);
         esp_matter::attribute::report(screen_endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id, &screen_val);
+        latency_trace_mark(DP_SCREEN, LATENCY_STAGE_REPORT, esp_timer_get_time());
+    }
+}
+
+void app_driver_get_report_stats(uint32_t *sent, uint32_t *suppressed)
+{
+    *sent = s_reports_sent;
+    *suppressed = s_reports_suppressed;
+}
+
+void app_driver_get_health(tuya_health_t *health)
+{
+    heater.GetHealth(health);
+}
+
+heater_state_t app_driver_get_state()
+{
+    return heater.GetState();
+}
+
+tuya_link_state_t app_driver_get_link_state()
+{
+    return heater.GetLinkState();
+}
+
+static void ScheduleStateUpdate()
+{
+    if (!s_update_scheduled.exchange(true, std::memory_order_acq_rel)) {
+        if (chip::DeviceLayer::PlatformMgr().ScheduleWork(AppDriverUpdateTask, 0) != CHIP_NO_ERROR) {
+            s_update_scheduled.store(false, std::memory_order_release);
+        }
     }
+}
 
-    free(data);
+static void tuya_state_change_callback(const heater_state_t *state, void *ctx)
+{
+    app_boot_mark(APP_BOOT_MCU_SYNCED); // Nothing is reported before the handshake
+    app_state_cache_update(state);
+    bool heating = heater_running_state(*state) != 0;
+    app_energy_update(heating, state->mode);
+    app_telemetry_update(heating);
+    // Kept even before Matter runs; set_defaults publishes it
+    s_state_mailbox.Store(*state);
+    if (s_matter_ready.load()) ScheduleStateUpdate();
 }
 
-static void tuya_state_change_callback(const heater_state_t *state)
+// --- BOOT RESTORE ---
+// State restored from flash. If the heater comes up from a power cut it
+// reports its power-on defaults, and the restored state is written back once
+// the handshake is done. If only the ESP restarted, the heater's state wins.
+static heater_state_t s_restored;
+static bool s_restore_pending = false;
+// Decided on the poll task, written on the Matter thread (see below)
+static std::atomic<bool> s_restore_writes(false);
+
+// Matter thread, so the writes join the same batch as attribute writes
+// instead of committing one that an interaction is still filling
+static void RestoreWritesTask(intptr_t context)
 {
-    if (thermostat_endpoint_id == 0) return;
-    AppEventData *data = (AppEventData *)malloc(sizeof(AppEventData));
-    if (data) {
-        data->state = *state;
-        chip::DeviceLayer::PlatformMgr().ScheduleWork(AppDriverUpdateTask, (intptr_t)data);
+    if (!s_restore_writes.exchange(false)) return;
+    heater_state_t now = heater.GetState();
+    OpenHeaterBatch();
+    if (now.target_temp != s_restored.target_temp) heater.SetTemp(s_restored.target_temp);
+    if (now.screen_on != s_restored.screen_on) heater.SetScreen(s_restored.screen_on);
+    if (!s_restored.power && now.power) heater.SetPower(false);
+#if !CONFIG_HEATER_LOCAL_CONTROL
+    if (s_restored.power && (!now.power || now.mode != s_restored.mode)) {
+        heater.SetPowerAndMode(true, s_restored.mode);
     }
+#endif
+}
+
+// Any task, once Matter runs; the task itself runs the writes at most once
+static void ScheduleRestoreWrites()
+{
+    if (s_restore_writes.load()) chip::DeviceLayer::PlatformMgr().ScheduleWork(RestoreWritesTask, 0);
+}
+
+// Poll task, after the controller's Update(): by the time the heartbeat
+// reply says how the MCU started, the controller has primed from its state
+static void RestoreAfterPowerCut()
+{
+    if (!s_restore_pending || !heater.IsSynced()) return;
+    tuya_mcu_boot_t boot = heater.GetMcuBoot();
+    if (boot == TUYA_MCU_BOOT_UNKNOWN) return;
+    s_restore_pending = false;
+    if (boot != TUYA_MCU_BOOT_FRESH) return;
+
+    ESP_LOGI(TAG, "Heater powered up with defaults, restoring %s, %d C",
+             s_restored.power ? "on" : "off", s_restored.target_temp);
+#if CONFIG_HEATER_LOCAL_CONTROL
+    // Power and mode are the controller's; it primed from the defaults
+    s_controller.SetSetpoint((int16_t)(s_restored.target_temp * 100));
+    s_controller.SetEnabled(s_restored.power);
+    if (s_matter_ready.load()) ScheduleStateUpdate(); // SystemMode follows
+#endif
+    // Before Matter is up, app_driver_thermostat_set_defaults schedules it
+    s_restore_writes.store(true);
+    if (s_matter_ready.load()) ScheduleRestoreWrites();
 }
 
 // --- FACTORY RESET HANDLER ---
-static void tuya_reset_callback()
+static void tuya_reset_callback(void *ctx)
 {
     ESP_LOGW(TAG, "Initiating Factory Reset due to Power Button sequence...");
     esp_matter::factory_reset();
@@ -102,23 +413,66 @@ static void tuya_reset_callback()
 static esp_err_t app_driver_thermostat_set_value(void *handle, esp_matter_attr_val_t *val, uint32_t attribute_id)
 {
     if (attribute_id == Thermostat::Attributes::SystemMode::Id) {
+        latency_trace_mark(DP_POWER, LATENCY_STAGE_DRIVER, esp_timer_get_time());
         uint8_t mode = val->val.u8;
+#if CONFIG_HEATER_LOCAL_CONTROL
+        // The controller picks power and stage; only "off" goes out directly
+        bool heat = (mode != (uint8_t)Thermostat::SystemModeEnum::kOff);
+        s_controller.SetEnabled(heat);
+        if (!heat) heater.SetPower(false);
+        heater_uart.Wake();
+#else
         if (mode == (uint8_t)Thermostat::SystemModeEnum::kOff) {
             heater.SetPower(false);
         } else {
             // Turn ON + Force High Mode (Combined Packet)
             heater.SetPowerAndMode(true, MODE_HIGH);
         }
+#endif
     }
     else if (attribute_id == Thermostat::Attributes::OccupiedHeatingSetpoint::Id) {
+        latency_trace_mark(DP_SET_TEMP, LATENCY_STAGE_DRIVER, esp_timer_get_time());
+#if CONFIG_HEATER_LOCAL_CONTROL
+        s_controller.SetSetpoint(val->val.i16);
+#endif
         heater.SetTemp(val->val.i16 / 100);
     }
     return ESP_OK;
 }
 
+// --- WRITE BATCHING ---
+// All attribute writes handled in one pass of the CHIP event loop (one Write
+// interaction, e.g. a scene) are sent to the MCU as a single 0x06 frame.
+// The setpoint is held back on its own for HEATER_SETPOINT_QUIET_MS, so it
+// never delays power or mode written alongside it.
+static bool s_batch_open = false;
+
+static void CommitHeaterBatch(intptr_t context)
+{
+    s_batch_open = false;
+    heater.CommitBatch();
+}
+
+static void OpenHeaterBatch()
+{
+    if (s_batch_open) return;
+    heater.BeginBatch();
+    // Runs once the current interaction has finished dispatching its writes
+    if (chip::DeviceLayer::PlatformMgr().ScheduleWork(CommitHeaterBatch, 0) == CHIP_NO_ERROR) {
+        s_batch_open = true;
+    } else {
+        heater.CommitBatch();
+    }
+}
+
 esp_err_t app_driver_attribute_update(app_driver_handle_t driver_handle, uint16_t endpoint_id, uint32_t cluster_id,
                                       uint32_t attribute_id, esp_matter_attr_val_t *val)
 {
+    esp_err_t bridge_err;
+    if (app_bridge_attribute_update(endpoint_id, cluster_id, attribute_id, val, &bridge_err)) return bridge_err;
+
+    OpenHeaterBatch();
+
     if (endpoint_id == thermostat_endpoint_id && cluster_id == Thermostat::Id) {
         return app_driver_thermostat_set_value(driver_handle, val, attribute_id);
     }
@@ -127,21 +481,34 @@ esp_err_t app_driver_attribute_update(app_driver_handle_t driver_handle, uint16_
         if (cluster_id == OnOff::Id && attribute_id == OnOff::Attributes::OnOff::Id) {
             bool on = val->val.b;
             ESP_LOGI(TAG, "Matter Command: Set Screen %s", on ? "ON" : "OFF");
+            latency_trace_mark(DP_SCREEN, LATENCY_STAGE_DRIVER, esp_timer_get_time());
             heater.SetScreen(on);
         }
     }
     return ESP_OK;
 }
 
-esp_err_t app_driver_thermostat_set_defaults(uint16_t endpoint_id) { return ESP_OK; }
+esp_err_t app_driver_thermostat_set_defaults(uint16_t endpoint_id)
+{
+    // The mailbox holds the state restored from flash, or the MCU's own if
+    // the handshake already finished during bring-up; publish it right away
+    s_matter_ready.store(true);
+    if (s_state_mailbox.Sequence() != 0) ScheduleStateUpdate();
+    ScheduleRestoreWrites();
+    return ESP_OK;
+}
 
 app_driver_handle_t app_driver_thermostat_init()
 {
-    heater.Init(TUYA_TX_PIN, TUYA_RX_PIN);
-    heater.SetStateCallback(tuya_state_change_callback);
-    // Register the Reset Callback
-    heater.SetResetCallback(tuya_reset_callback);
-    
+    heater_state_t restored;
+    bool found = false;
+    if (app_state_cache_init(&restored, &found) == ESP_OK && found) {
+        s_state_mailbox.Store(restored);
+        // Reconciled with the MCU's own state once it has synced
+        s_restored = restored;
+        s_restore_pending = true;
+    }
+
     xTaskCreate(tuya_poll_task, "tuya_poll", 4096, NULL, 5, NULL);
     return (app_driver_handle_t)1;
 }
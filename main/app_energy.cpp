@@ -0,0 +1,288 @@
+#include <app_priv.h>
+#include <esp_log.h>
+
+#if CONFIG_HEATER_ENERGY_METERING
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <nvs.h>
+#include <atomic>
+#include <mutex>
+#include <esp_matter.h>
+#include <platform/CHIPDeviceLayer.h>
+#include <app/clusters/electrical-power-measurement-server/electrical-power-measurement-server.h>
+#include <app/clusters/electrical-energy-measurement-server/electrical-energy-measurement-server.h>
+#include "energy_meter.h"
+#include "seqlock.h"
+
+using namespace chip;
+using namespace chip::app;
+using namespace chip::app::Clusters;
+using namespace esp_matter;
+
+static const char *TAG = "APP_ENERGY";
+
+#define ENERGY_NAMESPACE        "heater"
+#define ENERGY_KEY              "energy"
+#define ENERGY_PERSIST_MJ       ((uint64_t)CONFIG_HEATER_ENERGY_PERSIST_WH * 3600000ULL)
+#define ENERGY_MJ_PER_MWH       3600ULL
+
+// The draw is derived from the mode, not measured: claim +-10 %
+#define ENERGY_ACCURACY_PERCENT100THS 1000
+
+static uint16_t s_energy_endpoint_id = 0;
+
+// Written by the poll task on every state change, read from anywhere
+static EnergyMeter s_meter(CONFIG_HEATER_POWER_HIGH_W, CONFIG_HEATER_POWER_LOW_W, CONFIG_HEATER_POWER_ECO_W);
+static SeqLock<EnergyMeter> s_snapshot;
+
+static std::atomic<bool> s_started(false);
+static esp_timer_handle_t s_report_timer = nullptr;
+
+static std::mutex s_persist_lock;
+static uint64_t s_persisted_mj = 0;
+static uint32_t s_persist_count = 0;
+
+static int64_t now_ms()
+{
+    return esp_timer_get_time() / 1000;
+}
+
+// --- POWER MEASUREMENT DELEGATE ---
+// Only ActivePower is known. Everything else is null or an empty list.
+static ElectricalPowerMeasurement::Structs::MeasurementAccuracyRangeStruct::Type s_power_range;
+
+class HeaterPowerDelegate : public ElectricalPowerMeasurement::Delegate
+{
+public:
+    ElectricalPowerMeasurement::PowerModeEnum GetPowerMode() override { return ElectricalPowerMeasurement::PowerModeEnum::kAc; }
+    uint8_t GetNumberOfMeasurementTypes() override { return 1; }
+
+    CHIP_ERROR StartAccuracyRead() override { return CHIP_NO_ERROR; }
+    CHIP_ERROR GetAccuracyByIndex(uint8_t index, ElectricalPowerMeasurement::Structs::MeasurementAccuracyStruct::Type &accuracy) override
+    {
+        if (index != 0) return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+        accuracy.measurementType = ElectricalPowerMeasurement::MeasurementTypeEnum::kActivePower;
+        accuracy.measured = false;
+        accuracy.minMeasuredValue = 0;
+        accuracy.maxMeasuredValue = (int64_t)CONFIG_HEATER_POWER_HIGH_W * 1000;
+        accuracy.accuracyRanges = DataModel::List<const ElectricalPowerMeasurement::Structs::MeasurementAccuracyRangeStruct::Type>(&s_power_range, 1);
+        return CHIP_NO_ERROR;
+    }
+    CHIP_ERROR EndAccuracyRead() override { return CHIP_NO_ERROR; }
+
+    CHIP_ERROR StartRangesRead() override { return CHIP_NO_ERROR; }
+    CHIP_ERROR GetRangeByIndex(uint8_t, ElectricalPowerMeasurement::Structs::MeasurementRangeStruct::Type &) override
+    {
+        return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+    }
+    CHIP_ERROR EndRangesRead() override { return CHIP_NO_ERROR; }
+
+    CHIP_ERROR StartHarmonicCurrentsRead() override { return CHIP_NO_ERROR; }
+    CHIP_ERROR GetHarmonicCurrentsByIndex(uint8_t, ElectricalPowerMeasurement::Structs::HarmonicMeasurementStruct::Type &) override
+    {
+        return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+    }
+    CHIP_ERROR EndHarmonicCurrentsRead() override { return CHIP_NO_ERROR; }
+
+    CHIP_ERROR StartHarmonicPhasesRead() override { return CHIP_NO_ERROR; }
+    CHIP_ERROR GetHarmonicPhasesByIndex(uint8_t, ElectricalPowerMeasurement::Structs::HarmonicMeasurementStruct::Type &) override
+    {
+        return CHIP_ERROR_PROVIDER_LIST_EXHAUSTED;
+    }
+    CHIP_ERROR EndHarmonicPhasesRead() override { return CHIP_NO_ERROR; }
+
+    DataModel::Nullable<int64_t> GetActivePower() override
+    {
+        return DataModel::MakeNullable((int64_t)s_snapshot.Load().Watts() * 1000); // mW
+    }
+
+    DataModel::Nullable<int64_t> GetVoltage() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetActiveCurrent() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetReactiveCurrent() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetApparentCurrent() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetReactivePower() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetApparentPower() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetRMSVoltage() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetRMSCurrent() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetRMSPower() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetFrequency() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetPowerFactor() override { return DataModel::NullNullable; }
+    DataModel::Nullable<int64_t> GetNeutralCurrent() override { return DataModel::NullNullable; }
+};
+
+static HeaterPowerDelegate s_power_delegate;
+
+// --- PERSISTENCE ---
+// One u64 per CONFIG_HEATER_ENERGY_PERSIST_WH, plus the restart flush. A
+// power cut loses at most that much.
+static void persist(bool force)
+{
+    uint64_t energy = s_snapshot.Load().EnergyMj(now_ms());
+    std::lock_guard<std::mutex> lock(s_persist_lock);
+    if (!EnergyMeter::PersistDue(energy, s_persisted_mj, ENERGY_PERSIST_MJ, force)) return;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(ENERGY_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_u64(handle, ENERGY_KEY, energy);
+        if (err == ESP_OK) err = nvs_commit(handle);
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Persist failed: %s", esp_err_to_name(err));
+        return;
+    }
+    s_persisted_mj = energy;
+    s_persist_count++;
+}
+
+static void on_shutdown()
+{
+    persist(true);
+}
+
+// --- REPORTING ---
+// Matter thread. Runs on every change of draw and periodically while heating.
+static void ReportEnergyTask(intptr_t context)
+{
+    EnergyMeter meter = s_snapshot.Load();
+
+    ElectricalEnergyMeasurement::Structs::EnergyMeasurementStruct::Type imported;
+    imported.energy = (int64_t)(meter.EnergyMj(now_ms()) / ENERGY_MJ_PER_MWH);
+    ElectricalEnergyMeasurement::NotifyCumulativeEnergyMeasured(s_energy_endpoint_id, MakeOptional(imported), NullOptional);
+
+    static uint16_t s_reported_watts = UINT16_MAX;
+    if (meter.Watts() != s_reported_watts) {
+        s_reported_watts = meter.Watts();
+        MatterReportingAttributeChangeCallback(s_energy_endpoint_id, ElectricalPowerMeasurement::Id,
+                                               ElectricalPowerMeasurement::Attributes::ActivePower::Id);
+    }
+    persist(false);
+}
+
+static void energy_report_timer_cb(void *arg)
+{
+    PlatformMgr().ScheduleWork(ReportEnergyTask, 0);
+}
+
+esp_err_t app_energy_init()
+{
+    uint64_t energy = 0;
+    nvs_handle_t handle;
+    if (nvs_open(ENERGY_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u64(handle, ENERGY_KEY, &energy);
+        nvs_close(handle);
+    }
+    s_persisted_mj = energy;
+    s_meter.Restore(energy, now_ms());
+    s_snapshot.Store(s_meter);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = energy_report_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "energy_report",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_report_timer);
+    if (err != ESP_OK) return err;
+    esp_register_shutdown_handler(on_shutdown);
+
+    ESP_LOGI(TAG, "Restored %llu Wh", (unsigned long long)(energy / 3600000ULL));
+    return ESP_OK;
+}
+
+esp_err_t app_energy_create_endpoint(node_t *node)
+{
+    endpoint::electrical_sensor::config_t sensor_config;
+    sensor_config.electrical_power_measurement.delegate = &s_power_delegate;
+    sensor_config.electrical_power_measurement.feature_flags =
+        cluster::electrical_power_measurement::feature::alternating_current::get_id();
+    endpoint_t *ep = endpoint::electrical_sensor::create(node, &sensor_config, ENDPOINT_FLAG_NONE, NULL);
+    if (!ep) {
+        ESP_LOGE(TAG, "Failed to create electrical sensor endpoint");
+        return ESP_FAIL;
+    }
+
+    cluster::electrical_energy_measurement::config_t energy_config;
+    energy_config.feature_flags = cluster::electrical_energy_measurement::feature::imported_energy::get_id() |
+                                  cluster::electrical_energy_measurement::feature::cumulative_energy::get_id();
+    if (!cluster::electrical_energy_measurement::create(ep, &energy_config, CLUSTER_FLAG_SERVER)) {
+        ESP_LOGE(TAG, "Failed to create energy measurement cluster");
+        return ESP_FAIL;
+    }
+    s_energy_endpoint_id = endpoint::get_id(ep);
+    return ESP_OK;
+}
+
+// Matter thread, once after start
+static void StartEnergyTask(intptr_t context)
+{
+    static ElectricalEnergyMeasurement::Structs::MeasurementAccuracyRangeStruct::Type s_energy_range;
+    s_energy_range.rangeMin = 0;
+    s_energy_range.rangeMax = INT64_MAX;
+    s_energy_range.percentMax = MakeOptional((Percent100ths)ENERGY_ACCURACY_PERCENT100THS);
+
+    ElectricalEnergyMeasurement::Structs::MeasurementAccuracyStruct::Type accuracy;
+    accuracy.measurementType = ElectricalEnergyMeasurement::MeasurementTypeEnum::kElectricalEnergy;
+    accuracy.measured = false;
+    accuracy.minMeasuredValue = 0;
+    accuracy.maxMeasuredValue = INT64_MAX;
+    accuracy.accuracyRanges = DataModel::List<const ElectricalEnergyMeasurement::Structs::MeasurementAccuracyRangeStruct::Type>(&s_energy_range, 1);
+    ElectricalEnergyMeasurement::SetMeasurementAccuracy(s_energy_endpoint_id, accuracy);
+
+    ReportEnergyTask(0);
+}
+
+void app_energy_start()
+{
+    if (s_energy_endpoint_id == 0) return;
+    s_power_range.rangeMin = 0;
+    s_power_range.rangeMax = (int64_t)CONFIG_HEATER_POWER_HIGH_W * 1000;
+    s_power_range.percentMax = MakeOptional((Percent100ths)ENERGY_ACCURACY_PERCENT100THS);
+
+    s_started.store(true);
+    PlatformMgr().ScheduleWork(StartEnergyTask, 0);
+    // The heater may already have been running when the handshake finished
+    if (s_snapshot.Load().Watts()) {
+        esp_timer_start_periodic(s_report_timer, (uint64_t)CONFIG_HEATER_ENERGY_REPORT_S * 1000000ULL);
+    }
+}
+
+void app_energy_update(bool heating, uint8_t mode)
+{
+    uint16_t watts = s_meter.Watts();
+    s_meter.Update(heating, mode, now_ms());
+    if (s_meter.Watts() == watts) return;
+    s_snapshot.Store(s_meter);
+
+    if (!s_started.load()) return;
+    // Report the new draw right away; keep the total moving while heating
+    PlatformMgr().ScheduleWork(ReportEnergyTask, 0);
+    esp_timer_stop(s_report_timer);
+    if (s_meter.Watts()) {
+        esp_timer_start_periodic(s_report_timer, (uint64_t)CONFIG_HEATER_ENERGY_REPORT_S * 1000000ULL);
+    }
+}
+
+void app_energy_get_stats(app_energy_stats_t *stats)
+{
+    EnergyMeter meter = s_snapshot.Load();
+    int64_t now = now_ms();
+    stats->watts = meter.Watts();
+    stats->energy_wh = (uint32_t)(meter.EnergyMj(now) / 3600000ULL);
+    stats->duty_permille = meter.DutyPermille(now);
+    std::lock_guard<std::mutex> lock(s_persist_lock);
+    stats->persisted_wh = (uint32_t)(s_persisted_mj / 3600000ULL);
+    stats->persist_count = s_persist_count;
+}
+
+#else
+
+esp_err_t app_energy_init() { return ESP_OK; }
+esp_err_t app_energy_create_endpoint(esp_matter::node_t *node) { return ESP_OK; }
+void app_energy_start() {}
+void app_energy_update(bool heating, uint8_t mode) {}
+void app_energy_get_stats(app_energy_stats_t *stats) { *stats = {}; }
+
+#endif // CONFIG_HEATER_ENERGY_METERING
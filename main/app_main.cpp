@@ -1,5 +1,6 @@
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <nvs_flash.h>
 
 #include <esp_matter.h>
@@ -11,6 +12,7 @@
 
 #include <app_priv.h>
 #include <app_reset.h>
+#include "latency_trace.h"
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #include <platform/ESP32/OpenthreadLauncher.h>
 #endif
@@ -32,12 +34,28 @@ using namespace chip::DeviceLayer;
 #include <app/AttributeAccessInterface.h>
 #include <app/AttributeAccessInterfaceRegistry.h>
 #include <app/util/attribute-storage.h>
+#include <string.h>
+
+// Every endpoint below is dynamic: root, thermostat and screen, then the
+// energy sensor and the Aggregator plus one per bridged heater if enabled
+#if CONFIG_HEATER_ENERGY_METERING
+#define APP_ENERGY_ENDPOINTS 1
+#else
+#define APP_ENERGY_ENDPOINTS 0
+#endif
+#if CONFIG_HEATER_BRIDGE
+#define APP_BRIDGE_ENDPOINTS (1 + CONFIG_HEATER_BRIDGE_COUNT)
+#else
+#define APP_BRIDGE_ENDPOINTS 0
+#endif
+#if CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT < 3 + APP_ENERGY_ENDPOINTS + APP_BRIDGE_ENDPOINTS
+#error "CONFIG_ESP_MATTER_MAX_DYNAMIC_ENDPOINT_COUNT is too small for the heater's endpoints"
+#endif
 
 static const char *TAG = "app_main";
 uint16_t thermostat_endpoint_id = 0;
 uint16_t screen_endpoint_id = 0;
 
-extern int16_t g_current_temp_int; 
 
 using namespace esp_matter;
 using namespace esp_matter::attribute;
@@ -62,9 +80,16 @@ public:
     CHIP_ERROR Read(const chip::app::ConcreteReadAttributePath & aPath, chip::app::AttributeValueEncoder & aEncoder) override
     {
         if (aPath.mAttributeId == Thermostat::Attributes::LocalTemperature::Id) {
-            // Log for verification
-            ESP_LOGI("AAI", "** AAI READ: Current Temp = %d **", g_current_temp_int);
-            return aEncoder.Encode(g_current_temp_int);
+            // Filtered value (raw for bridged heaters); null = no trustworthy
+            // reading (not synced yet, or MCU link lost)
+            app_local_temp_t temp;
+            if (!app_bridge_get_local_temp(aPath.mEndpointId, &temp)) {
+                temp = app_driver_get_local_temp();
+            }
+            if (!temp.valid) {
+                return aEncoder.EncodeNull();
+            }
+            return aEncoder.Encode(temp.value);
         }
         return CHIP_NO_ERROR;
     }
@@ -72,11 +97,81 @@ public:
 
 static LocalTempAccessor sLocalTempAccessor;
 
+// Vendor diagnostics cluster: attribute id -> tuya_health_t counter
+static const struct {
+    uint32_t attribute_id;
+    size_t offset;
+} k_heater_diag_counters[] = {
+    { HEATER_DIAG_ATTR_BYTES_IN,         offsetof(tuya_health_t, bytes_in) },
+    { HEATER_DIAG_ATTR_BYTES_OUT,        offsetof(tuya_health_t, bytes_out) },
+    { HEATER_DIAG_ATTR_FRAMES_OK,        offsetof(tuya_health_t, frames_ok) },
+    { HEATER_DIAG_ATTR_FRAMES_BAD_CSUM,  offsetof(tuya_health_t, frames_bad_checksum) },
+    { HEATER_DIAG_ATTR_RESYNC_BYTES,     offsetof(tuya_health_t, resync_bytes) },
+    { HEATER_DIAG_ATTR_OVERFLOWS,        offsetof(tuya_health_t, overflows) },
+    { HEATER_DIAG_ATTR_UNKNOWN_DPS,      offsetof(tuya_health_t, unknown_dps) },
+    { HEATER_DIAG_ATTR_UNKNOWN_COMMANDS, offsetof(tuya_health_t, unknown_commands) },
+    { HEATER_DIAG_ATTR_BAD_DPS,          offsetof(tuya_health_t, bad_dps) },
+    { HEATER_DIAG_ATTR_FRAMES_SENT,      offsetof(tuya_health_t, frames_sent) },
+    { HEATER_DIAG_ATTR_COMMANDS_SENT,    offsetof(tuya_health_t, commands_sent) },
+    { HEATER_DIAG_ATTR_RETRIES,          offsetof(tuya_health_t, retries) },
+    { HEATER_DIAG_ATTR_TIMEOUTS,         offsetof(tuya_health_t, timeouts) },
+};
+
+class HeaterDiagAccessor : public chip::app::AttributeAccessInterface
+{
+public:
+    HeaterDiagAccessor() : AttributeAccessInterface(chip::Optional<chip::EndpointId>::Missing(), HEATER_DIAG_CLUSTER_ID) {}
+
+    CHIP_ERROR Read(const chip::app::ConcreteReadAttributePath & aPath, chip::app::AttributeValueEncoder & aEncoder) override
+    {
+        if (aPath.mAttributeId == HEATER_DIAG_ATTR_LINK_STATE) {
+            return aEncoder.Encode((uint8_t)app_driver_get_link_state());
+        }
+        for (const auto &counter : k_heater_diag_counters) {
+            if (counter.attribute_id == aPath.mAttributeId) {
+                tuya_health_t health;
+                app_driver_get_health(&health);
+                uint32_t value;
+                memcpy(&value, (const uint8_t *)&health + counter.offset, sizeof(value));
+                return aEncoder.Encode(value);
+            }
+        }
+        return CHIP_NO_ERROR; // Global attributes come from the data model
+    }
+};
+
+static HeaterDiagAccessor sHeaterDiagAccessor;
+
+static void create_heater_diag_cluster(node_t *node)
+{
+    endpoint_t *root = endpoint::get(node, 0);
+    cluster_t *cluster = cluster::create(root, HEATER_DIAG_CLUSTER_ID, CLUSTER_FLAG_SERVER);
+    if (!cluster) {
+        ESP_LOGE(TAG, "Failed to create heater diagnostics cluster");
+        return;
+    }
+    cluster::global::attribute::create_cluster_revision(cluster, 1);
+    cluster::global::attribute::create_feature_map(cluster, 0);
+
+    // Placeholders so the paths exist; reads are answered by sHeaterDiagAccessor
+    for (const auto &counter : k_heater_diag_counters) {
+        attribute::create(cluster, counter.attribute_id, ATTRIBUTE_FLAG_NONE, esp_matter_uint32(0));
+    }
+    attribute::create(cluster, HEATER_DIAG_ATTR_LINK_STATE, ATTRIBUTE_FLAG_NONE, esp_matter_enum8(0));
+
+    chip::app::AttributeAccessInterfaceRegistry::Instance().Register(&sHeaterDiagAccessor);
+}
+
 static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
 {
     switch (event->Type) {
     case chip::DeviceLayer::DeviceEventType::kInterfaceIpAddressChanged:
         ESP_LOGI(TAG, "Interface IP Address changed");
+        app_boot_mark(APP_BOOT_IP_READY);
+        break;
+
+    case chip::DeviceLayer::DeviceEventType::kServerReady:
+        app_boot_mark(APP_BOOT_SERVER_READY);
         break;
 
     case chip::DeviceLayer::DeviceEventType::kCommissioningComplete:
@@ -158,6 +253,7 @@ static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16
                                          uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
 {
     if (type == PRE_UPDATE) {
+        latency_trace_write_received(esp_timer_get_time());
         return app_driver_attribute_update((app_driver_handle_t)priv_data, endpoint_id, cluster_id, attribute_id, val);
     }
     return ESP_OK;
@@ -165,8 +261,16 @@ static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16
 
 extern "C" void app_main()
 {
+    esp_err_t err = ESP_OK;
+    app_boot_mark(APP_BOOT_APP_MAIN);
     nvs_flash_init();
+    app_power_init();
+    app_energy_init();
+    app_telemetry_init();
+    app_boot_mark(APP_BOOT_NVS_READY);
 
+    // Returns right away; the poll task opens the UART and runs the MCU
+    // handshake while the Matter stack comes up below
     app_driver_handle_t thermostat_handle = app_driver_thermostat_init();
     app_driver_handle_t button_handle = app_driver_button_init();
     app_reset_button_register(button_handle);
@@ -186,6 +290,10 @@ extern "C" void app_main()
     // Create the endpoint
     endpoint_t *screen_ep = esp_matter::endpoint::on_off_plug_in_unit::create(node, &screen_config, ENDPOINT_FLAG_NONE, NULL);
     screen_endpoint_id = endpoint::get_id(screen_ep);
+    err = app_energy_create_endpoint(node);
+    ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to create the energy endpoint, err: %d", err));
+    err = app_bridge_create_endpoints(node);
+    ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to create the bridged endpoints, err: %d", err));
 
     // --- REGISTER ATTRIBUTES ---
     esp_matter::cluster_t *cluster = esp_matter::cluster::get(endpoint, Thermostat::Id);
@@ -201,14 +309,26 @@ extern "C" void app_main()
             esp_matter::attribute::create(cluster, Thermostat::Attributes::ThermostatRunningState::Id, ATTRIBUTE_FLAG_NULLABLE, esp_matter_bitmap16(0));
         }
 
+        // Slider drags write these many times a second; batch them in NVS
+        attribute::set_deferred_persistence(attribute::get(cluster, Thermostat::Attributes::SystemMode::Id));
+        attribute::set_deferred_persistence(attribute::get(cluster, Thermostat::Attributes::OccupiedHeatingSetpoint::Id));
+
         // Force Flags
-        esp_matter_attr_val_t feature_val = esp_matter_bitmap32(1); 
+        uint32_t features = (uint32_t)Thermostat::Feature::kHeating;
+#if CONFIG_HEATER_SCHEDULE
+        features |= (uint32_t)Thermostat::Feature::kScheduleConfiguration;
+#endif
+        esp_matter_attr_val_t feature_val = esp_matter_bitmap32(features);
         attribute::update(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::FeatureMap::Id, &feature_val);
         esp_matter_attr_val_t seq_val = esp_matter_enum8(2); 
         attribute::update(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::ControlSequenceOfOperation::Id, &seq_val);
     }
 
+    err = app_schedule_create_clusters(node);
+    ABORT_APP_ON_FAILURE(err == ESP_OK, ESP_LOGE(TAG, "Failed to create the schedule clusters, err: %d", err));
+
     chip::app::AttributeAccessInterfaceRegistry::Instance().Register(&sLocalTempAccessor);
+    create_heater_diag_cluster(node);
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD && CHIP_DEVICE_CONFIG_ENABLE_WIFI_STATION
     // Enable secondary network interface
     secondary_network_interface::config_t secondary_network_interface_config;
@@ -235,8 +355,13 @@ extern "C" void app_main()
 #endif
 #endif // CONFIG_ENABLE_SET_CERT_DECLARATION_API
 
+    app_boot_mark(APP_BOOT_DATA_MODEL);
     esp_matter::start(app_event_cb);
+    app_boot_mark(APP_BOOT_MATTER_STARTED);
     app_driver_thermostat_set_defaults(thermostat_endpoint_id);
+    app_schedule_init();
+    app_energy_start();
+    app_bridge_start();
 
     #if CONFIG_ENABLE_ENCRYPTED_OTA
     err = esp_matter_ota_requestor_encrypted_init(s_decryption_key, s_decryption_key_len);
@@ -248,6 +373,7 @@ extern "C" void app_main()
     esp_matter::console::wifi_register_commands();
     esp_matter::console::factoryreset_register_commands();
     esp_matter::console::attribute_register_commands();
+    app_console_register_commands();
 #if CONFIG_OPENTHREAD_CLI
     esp_matter::console::otcli_register_commands();
 #endif
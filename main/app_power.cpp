@@ -0,0 +1,117 @@
+#include <app_priv.h>
+#include <esp_log.h>
+#include <string.h>
+
+#if CONFIG_HEATER_LOW_POWER
+#include <esp_pm.h>
+#include <esp_timer.h>
+#include <esp_attr.h>
+#include <atomic>
+
+static const char *TAG = "APP_POWER";
+
+// Updated from the light-sleep exit hook (runs with the scheduler stopped)
+static std::atomic<uint32_t> s_wakeups(0);
+static std::atomic<uint64_t> s_asleep_us(0);
+
+static app_power_stats_t s_last_period;
+static int64_t s_period_start_us = 0;
+static uint32_t s_period_wakeups = 0;
+static uint64_t s_period_asleep_us = 0;
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+static esp_err_t IRAM_ATTR on_light_sleep_exit(int64_t slept_us, void *arg)
+{
+    s_wakeups.fetch_add(1, std::memory_order_relaxed);
+    s_asleep_us.fetch_add((uint64_t)slept_us, std::memory_order_relaxed);
+    return ESP_OK;
+}
+#endif
+
+static void power_stats_timer_cb(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t wakeups = s_wakeups.load(std::memory_order_relaxed);
+    uint64_t asleep = s_asleep_us.load(std::memory_order_relaxed);
+
+    uint32_t elapsed_ms = (uint32_t)((now - s_period_start_us) / 1000);
+    s_last_period.wakeups = wakeups - s_period_wakeups;
+    s_last_period.asleep_ms = (uint32_t)((asleep - s_period_asleep_us) / 1000);
+    s_last_period.period_ms = elapsed_ms;
+
+    s_period_start_us = now;
+    s_period_wakeups = wakeups;
+    s_period_asleep_us = asleep;
+
+    uint32_t per_min = elapsed_ms ? (uint32_t)((uint64_t)s_last_period.wakeups * 60000 / elapsed_ms) : 0;
+    uint32_t pct = elapsed_ms ? (uint32_t)((uint64_t)s_last_period.asleep_ms * 100 / elapsed_ms) : 0;
+    ESP_LOGI(TAG, "%lu wake-ups/min, asleep %lu%% of the last %lu s",
+             (unsigned long)per_min, (unsigned long)pct, (unsigned long)(elapsed_ms / 1000));
+}
+
+esp_err_t app_power_init()
+{
+    memset(&s_last_period, 0, sizeof(s_last_period));
+
+    // Tickless idle drops into light sleep whenever no task and no PM lock
+    // needs the CPU; Thread (as a sleepy end device) and the Tuya UART hold
+    // locks only while they have work in flight.
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = (int)CONFIG_XTAL_FREQ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_pm_configure failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {};
+    cbs.exit_cb = on_light_sleep_exit;
+    err = esp_pm_light_sleep_register_cbs(&cbs);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Sleep statistics unavailable: %s", esp_err_to_name(err));
+    }
+#endif
+
+    s_period_start_us = esp_timer_get_time();
+#if CONFIG_HEATER_POWER_STATS_PERIOD_S > 0
+    const esp_timer_create_args_t timer_args = {
+        .callback = power_stats_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "power_stats",
+        .skip_unhandled_events = true,
+    };
+    esp_timer_handle_t timer;
+    if (esp_timer_create(&timer_args, &timer) == ESP_OK) {
+        esp_timer_start_periodic(timer, (uint64_t)CONFIG_HEATER_POWER_STATS_PERIOD_S * 1000000);
+    }
+#endif
+
+    ESP_LOGI(TAG, "Light sleep enabled (%d-%d MHz)", pm_config.min_freq_mhz, pm_config.max_freq_mhz);
+    return ESP_OK;
+}
+
+void app_power_get_stats(app_power_stats_t *stats)
+{
+    *stats = s_last_period;
+    stats->total_wakeups = s_wakeups.load(std::memory_order_relaxed);
+    stats->total_asleep_ms = (uint32_t)(s_asleep_us.load(std::memory_order_relaxed) / 1000);
+}
+
+#else // !CONFIG_HEATER_LOW_POWER
+
+esp_err_t app_power_init()
+{
+    return ESP_OK;
+}
+
+void app_power_get_stats(app_power_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+#endif
@@ -2,6 +2,8 @@
 
 #include <esp_err.h>
 #include <esp_matter.h>
+#include "tuya_driver.h"
+#include "tuya_poll_group.h"
 
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #include "esp_openthread_types.h"
@@ -11,6 +13,16 @@
 #define TUYA_TX_PIN 16
 #define TUYA_RX_PIN 17
 
+// 1 = RX woken by UART driver events, 0 = legacy 50 ms polling loop
+#define TUYA_RX_EVENT_DRIVEN 1
+
+// Slider drags produce a write per step; only send the value it settles on
+#define HEATER_SETPOINT_QUIET_MS 400
+
+#if CONFIG_HEATER_LOW_POWER && !TUYA_RX_EVENT_DRIVEN
+#error "CONFIG_HEATER_LOW_POWER needs TUYA_RX_EVENT_DRIVEN: polling keeps the chip awake"
+#endif
+
 typedef void *app_driver_handle_t;
 
 app_driver_handle_t app_driver_thermostat_init();
@@ -21,6 +33,220 @@ esp_err_t app_driver_attribute_update(app_driver_handle_t driver_handle, uint16_
 
 esp_err_t app_driver_thermostat_set_defaults(uint16_t endpoint_id);
 
+// LocalTemperature as served by the AAI (0.01 °C). One snapshot, so a reader
+// never pairs a fresh validity flag with a stale value.
+typedef struct {
+    int16_t value;
+    bool valid;
+} app_local_temp_t;
+
+app_local_temp_t app_driver_get_local_temp();
+heater_state_t app_driver_get_state();
+
+// Attribute reports issued vs. skipped because the value did not change
+void app_driver_get_report_stats(uint32_t *sent, uint32_t *suppressed);
+
+// Tuya protocol health counters and link state (safe from any task)
+void app_driver_get_health(tuya_health_t *health);
+tuya_link_state_t app_driver_get_link_state();
+
+// Shared RX task servicing every heater's UART: wake-ups, busy time and
+// per-port poll cost since the last reset
+tuya_poll_group_stats_t app_driver_get_rx_stats();
+void app_driver_reset_rx_stats();
+// Transmit queue of heater `heater` (0 = main): depth, drops, wait per priority
+bool app_driver_get_tx_stats(int heater, tuya_tx_stats_t *stats);
+
+// --- THERMOSTAT REPORTING ---
+// One heater's state as Matter sees it, shared by the main heater and the
+// bridged ones so both report the same way (Matter thread)
+enum : uint32_t {
+    STATE_FIELD_LOCAL_TEMP    = 1 << 0,
+    STATE_FIELD_SETPOINT      = 1 << 1,
+    STATE_FIELD_SYSTEM_MODE   = 1 << 2,
+    STATE_FIELD_RUNNING_STATE = 1 << 3,
+    STATE_FIELD_SCREEN        = 1 << 4,
+    STATE_FIELD_ALL           = 0x1F,
+};
+// ThermostatRunningState bits; local_control: the ESP runs the PI loop
+uint16_t app_heater_running_state(const heater_state_t &state, bool local_control);
+// STATE_FIELD_* bits that moved; SystemMode is the caller's to compare
+uint32_t app_heater_changed_fields(const heater_state_t &prev, const heater_state_t &next, bool local_control);
+// Reports setpoint, SystemMode (heat) and running state if set in changed
+void app_heater_report_thermostat(uint16_t endpoint_id, const heater_state_t &state, bool heat, bool local_control,
+                                  uint32_t changed);
+
+// --- MATTER BRIDGE (CONFIG_HEATER_BRIDGE) ---
+// Heaters 2..N, each on its own UART and shown as a bridged thermostat under
+// an Aggregator endpoint. Their drivers join the main heater's RX task.
+esp_err_t app_bridge_create_endpoints(esp_matter::node_t *node);
+void app_bridge_open(TuyaPollGroup *group);     // RX task, before it runs the group
+void app_bridge_start();                        // After esp_matter::start
+// False if endpoint_id is not a bridged heater; else *err is the write's result
+bool app_bridge_attribute_update(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id,
+                                 esp_matter_attr_val_t *val, esp_err_t *err);
+bool app_bridge_get_local_temp(uint16_t endpoint_id, app_local_temp_t *temp);
+
+// --- BOOT PROFILE ---
+// First-reached timestamps of the startup phases, dumped by "heater boot"
+typedef enum {
+    APP_BOOT_APP_MAIN,
+    APP_BOOT_NVS_READY,
+    APP_BOOT_UART_OPEN,         // Poll task has the UART, handshake starts
+    APP_BOOT_DATA_MODEL,        // Endpoints and attributes created
+    APP_BOOT_MATTER_STARTED,    // esp_matter::start() returned
+    APP_BOOT_SERVER_READY,
+    APP_BOOT_IP_READY,          // First IPv6 address (Thread attached)
+    APP_BOOT_MCU_SYNCED,
+    APP_BOOT_FIRST_REPORT,      // Heater state first published to Matter
+    APP_BOOT_PHASE_COUNT
+} app_boot_phase_t;
+
+typedef struct {
+    uint32_t handshake_ms;      // uart open -> mcu synced
+    uint32_t bringup_ms;        // nvs ready -> matter started
+    uint32_t overlap_ms;        // Saved by running the two concurrently
+} app_boot_overlap_t;
+
+void app_boot_mark(app_boot_phase_t phase);
+uint32_t app_boot_get_us(app_boot_phase_t phase);
+const char *app_boot_phase_name(app_boot_phase_t phase);
+void app_boot_get_overlap(app_boot_overlap_t *out);
+
+// --- WEEKLY SCHEDULE (CONFIG_HEATER_SCHEDULE) ---
+// Transitions are applied from one timer armed for the next one, through
+// the same attribute path as a controller write. The wall clock comes from
+// Time Synchronization (SetUTCTime), SNTP or the console.
+esp_err_t app_schedule_create_clusters(esp_matter::node_t *node);  // Thermostat SCH commands, Time Sync
+esp_err_t app_schedule_init();                                      // After esp_matter::start
+
+#if CONFIG_HEATER_SCHEDULE
+#include "heater_schedule.h"
+
+typedef struct {
+    schedule_transition_t table[SCHEDULE_MAX_TRANSITIONS];
+    int count;
+    int next;                   // Index into table, -1 if none or no clock
+    bool clock_valid;
+    uint16_t now;               // Local minute of the week, if clock_valid
+    int second;
+    uint32_t applied;           // Transitions applied since boot
+} app_schedule_info_t;
+
+esp_err_t app_schedule_set_days(uint8_t days, const schedule_transition_t *day_transitions, int count);
+esp_err_t app_schedule_clear(uint8_t days);
+void app_schedule_get(app_schedule_info_t *info);
+esp_err_t app_schedule_set_clock(int64_t unix_seconds);
+#endif
+
+// --- ENERGY METERING (CONFIG_HEATER_ENERGY_METERING) ---
+// Electrical sensor endpoint with ActivePower and imported cumulative energy,
+// derived from the per-mode draw and integrated on every state change
+typedef struct {
+    uint16_t watts;             // Current draw
+    uint32_t energy_wh;         // Since the counter was first started
+    uint32_t duty_permille;     // Share of time heating since boot
+    uint32_t persisted_wh;
+    uint32_t persist_count;     // NVS writes since boot
+} app_energy_stats_t;
+
+esp_err_t app_energy_init();
+esp_err_t app_energy_create_endpoint(esp_matter::node_t *node);
+void app_energy_start();
+void app_energy_update(bool heating, uint8_t mode);     // Poll task
+void app_energy_get_stats(app_energy_stats_t *stats);
+
+// --- TELEMETRY HISTORY (CONFIG_HEATER_TELEMETRY) ---
+// Periodic samples of temperatures, power, mode and heating duty, delta
+// encoded into a RAM ring; sealed blocks optionally spill to flash
+esp_err_t app_telemetry_init();
+void app_telemetry_update(bool heating);    // Poll task, on every state change
+
+#if CONFIG_HEATER_TELEMETRY
+#include "telemetry_log.h"
+
+typedef struct {
+    uint32_t samples;           // Since boot
+    size_t bytes_used;
+    size_t capacity;
+    uint32_t flash_blocks;      // 0 = no flash spill
+    uint32_t flash_written;     // Blocks spilled since boot
+} app_telemetry_stats_t;
+
+// Streams every stored sample, oldest first, without allocating
+void app_telemetry_export(bool include_flash, telemetry_visit_cb_t visit, void *ctx);
+void app_telemetry_get_stats(app_telemetry_stats_t *stats);
+#endif
+
+// --- PERSISTED STATE CACHE ---
+// RAM copy of the heater state, written to NVS only after a quiet period
+// (bounded by a maximum delay) or on restart. Restore runs before Matter starts.
+esp_err_t app_state_cache_init(heater_state_t *restored, bool *found);
+void app_state_cache_update(const heater_state_t *state);
+void app_state_cache_flush();
+void app_state_cache_get_stats(uint32_t *commits, uint32_t *skipped);
+
+// --- CONSOLE ---
+// "matter esp heater <subcommand>" (CONFIG_ENABLE_CHIP_SHELL builds only)
+void app_console_register_commands();
+
+// --- PARSER BENCHMARK ---
+typedef enum {
+    APP_BENCH_CLEAN,    // Back-to-back frames in 64 byte reads
+    APP_BENCH_NOISY,    // Random bytes (many stray 0x55) between frames
+    APP_BENCH_SPLIT,    // Frames cut into 1..7 byte reads
+} app_bench_stream_t;
+
+// Keeps the cycle counter (32-bit) from wrapping during one run
+#define APP_BENCH_MAX_REPS 1000
+
+typedef struct {
+    uint64_t bytes;
+    uint32_t frames;
+    uint32_t frames_expected;   // Noise may legitimately fake a header and cost a frame
+    uint32_t elapsed_us;
+    uint32_t cycles;
+    uint32_t bytes_per_sec;
+    uint32_t cycles_per_frame;
+    bool accounting_ok;         // Every byte fed ended up in a frame, dropped or pending
+    bool stalled;
+} app_bench_result_t;
+
+// Runs `reps` passes over a 2 KB synthetic stream on a private parser
+esp_err_t app_bench_parser(app_bench_stream_t kind, int reps, app_bench_result_t *result);
+
+// --- VENDOR DIAGNOSTICS CLUSTER (root endpoint) ---
+// Manufacturer-specific cluster (test vendor 0xFFF1) mirroring tuya_health_t.
+// Values are served live by an AttributeAccessInterface, nothing is stored.
+#define HEATER_DIAG_CLUSTER_ID              0xFFF1FC01
+#define HEATER_DIAG_ATTR_BYTES_IN           0x0000
+#define HEATER_DIAG_ATTR_BYTES_OUT          0x0001
+#define HEATER_DIAG_ATTR_FRAMES_OK          0x0002
+#define HEATER_DIAG_ATTR_FRAMES_BAD_CSUM    0x0003
+#define HEATER_DIAG_ATTR_RESYNC_BYTES       0x0004
+#define HEATER_DIAG_ATTR_OVERFLOWS          0x0005
+#define HEATER_DIAG_ATTR_UNKNOWN_DPS        0x0006
+#define HEATER_DIAG_ATTR_UNKNOWN_COMMANDS   0x0007
+#define HEATER_DIAG_ATTR_COMMANDS_SENT      0x0008
+#define HEATER_DIAG_ATTR_RETRIES            0x0009
+#define HEATER_DIAG_ATTR_TIMEOUTS           0x000A
+#define HEATER_DIAG_ATTR_LINK_STATE         0x000B
+#define HEATER_DIAG_ATTR_BAD_DPS            0x000C
+#define HEATER_DIAG_ATTR_FRAMES_SENT        0x000D
+
+// --- POWER MANAGEMENT (CONFIG_HEATER_LOW_POWER) ---
+typedef struct {
+    uint32_t wakeups;           // Light-sleep exits in the last stats period
+    uint32_t asleep_ms;         // Time asleep in the last stats period
+    uint32_t period_ms;
+    uint32_t total_wakeups;     // Since boot
+    uint32_t total_asleep_ms;
+} app_power_stats_t;
+
+// Enables DFS + automatic light sleep. No-op unless CONFIG_HEATER_LOW_POWER.
+esp_err_t app_power_init();
+void app_power_get_stats(app_power_stats_t *stats);
+
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #define ESP_OPENTHREAD_DEFAULT_RADIO_CONFIG() { .radio_mode = RADIO_MODE_NATIVE, }
 #define ESP_OPENTHREAD_DEFAULT_HOST_CONFIG() { .host_connection_mode = HOST_CONNECTION_MODE_NONE, }
@@ -0,0 +1,365 @@
+#include <app_priv.h>
+#include <esp_log.h>
+
+#if CONFIG_HEATER_SCHEDULE
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <nvs.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <mutex>
+#include <esp_matter.h>
+#include <app/CommandHandler.h>
+#include <platform/CHIPDeviceLayer.h>
+#include "heater_schedule.h"
+
+using namespace chip::app::Clusters;
+using namespace esp_matter;
+using chip::app::CommandHandler;
+using chip::app::ConcreteCommandPath;
+using chip::Protocols::InteractionModel::Status;
+namespace Transition = Thermostat::Structs::WeeklyScheduleTransitionStruct;
+
+static const char *TAG = "APP_SCHEDULE";
+extern uint16_t thermostat_endpoint_id;
+
+#define SCHEDULE_NAMESPACE      "heater"
+#define SCHEDULE_KEY            "schedule"
+
+// Anything earlier means the wall clock was never set
+#define SCHEDULE_CLOCK_VALID_S  1704067200  // 2024-01-01
+// Only while waiting for the clock; transitions themselves are never polled.
+// Also how long a clock set by SetUTCTime takes to be picked up.
+#define SCHEDULE_CLOCK_RETRY_S  60
+
+// Per day over Matter, so that every day can hold this many at once
+#define SCHEDULE_DAILY_TRANSITIONS  (SCHEDULE_MAX_TRANSITIONS / SCHEDULE_DAYS)
+
+// The table is edited from the console and read by the timer; both are rare
+static std::mutex s_lock;
+static WeeklySchedule s_schedule;
+static esp_timer_handle_t s_timer = nullptr;
+// Wall-clock minute (see wall_minutes()) at which the transition last applied
+// fired. A minute of the week alone repeats every week, so a single-entry
+// schedule would only ever fire once.
+static int64_t s_applied_at = -1;   // -1 = none
+static uint32_t s_applied_count = 0;
+
+// Minutes since 1970-01-01 00:00 on the local wall clock. Unlike Unix time
+// it follows DST, so "now minus minutes since the transition" gives the same
+// value for one occurrence whenever it is computed.
+static int64_t wall_minutes(const struct tm &tm)
+{
+    int y = tm.tm_year + 1900;
+    int64_t days = 365LL * (y - 1970) + ((y - 1) / 4 - (y - 1) / 100 + (y - 1) / 400) -
+                   (1969 / 4 - 1969 / 100 + 1969 / 400) + tm.tm_yday;
+    return days * SCHEDULE_MINUTES_PER_DAY + tm.tm_hour * 60 + tm.tm_min;
+}
+
+static bool local_minute_of_week(uint16_t *minute, int *second, int64_t *wall_minute = nullptr)
+{
+    time_t now = time(NULL);
+    if (now < SCHEDULE_CLOCK_VALID_S) return false;
+    struct tm tm;
+    localtime_r(&now, &tm);
+    *minute = (uint16_t)(tm.tm_wday * SCHEDULE_MINUTES_PER_DAY + tm.tm_hour * 60 + tm.tm_min);
+    *second = tm.tm_sec;
+    if (wall_minute) *wall_minute = wall_minutes(tm);
+    return true;
+}
+
+// Matter thread: the same attribute path a controller write takes, so the
+// driver, local control, persistence and reporting all follow
+static void ApplyTransitionTask(intptr_t context)
+{
+    int16_t setpoint = (int16_t)context;
+    esp_matter_attr_val_t val;
+    if (setpoint == SCHEDULE_OFF) {
+        val = esp_matter_enum8((uint8_t)Thermostat::SystemModeEnum::kOff);
+        attribute::update(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::SystemMode::Id, &val);
+        return;
+    }
+    val = esp_matter_int16(setpoint);
+    attribute::update(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::OccupiedHeatingSetpoint::Id, &val);
+    val = esp_matter_enum8((uint8_t)Thermostat::SystemModeEnum::kHeat);
+    attribute::update(thermostat_endpoint_id, Thermostat::Id, Thermostat::Attributes::SystemMode::Id, &val);
+}
+
+// Caller holds s_lock. A table that was just loaded or edited, or a clock
+// that was just set, takes over the transition in force without applying it:
+// the current state reflects it already, or a manual change that should stand.
+static void arm_locked()
+{
+    if (!s_timer) return;
+    esp_timer_stop(s_timer);
+    if (s_schedule.Count() == 0) return;
+
+    uint16_t now;
+    int second;
+    int64_t wall;
+    int64_t delay_s = SCHEDULE_CLOCK_RETRY_S;
+    if (local_minute_of_week(&now, &second, &wall)) {
+        if (s_applied_at < 0) s_applied_at = wall - WeeklySchedule::MinutesSince(now, s_schedule.Current(now));
+        const schedule_transition_t *next = s_schedule.Next(now);
+        delay_s = (int64_t)WeeklySchedule::MinutesUntil(now, next) * 60 - second;
+    }
+    esp_timer_start_once(s_timer, delay_s * 1000000LL);
+}
+
+static void schedule_timer_cb(void *arg)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    uint16_t now;
+    int second;
+    int64_t wall;
+    if (local_minute_of_week(&now, &second, &wall) && s_applied_at >= 0) {
+        // Woken early (DST, clock step) this is still the applied transition;
+        // woken late it is the newest one that has passed
+        const schedule_transition_t *cur = s_schedule.Current(now);
+        int64_t at = cur ? wall - WeeklySchedule::MinutesSince(now, cur) : -1;
+        if (cur && at != s_applied_at) {
+            s_applied_at = at;
+            s_applied_count++;
+            ESP_LOGI(TAG, "Transition day %d %02d:%02d -> %d", cur->minute / SCHEDULE_MINUTES_PER_DAY,
+                     (cur->minute % SCHEDULE_MINUTES_PER_DAY) / 60, cur->minute % 60, cur->setpoint);
+            chip::DeviceLayer::PlatformMgr().ScheduleWork(ApplyTransitionTask, (intptr_t)cur->setpoint);
+        }
+    }
+    arm_locked();
+}
+
+// lwIP thread. Corrections only move the timer; the first sync after boot
+// takes over the transition in force like any newly set clock.
+static void sntp_sync_cb(struct timeval *tv)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    arm_locked();
+}
+
+// Caller holds s_lock. Edits are rare, so they go straight to flash.
+static esp_err_t save_locked()
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(SCHEDULE_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) return err;
+    if (s_schedule.Count() == 0) {
+        err = nvs_erase_key(handle, SCHEDULE_KEY);
+        if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+    } else {
+        err = nvs_set_blob(handle, SCHEDULE_KEY, s_schedule.Table(), s_schedule.Count() * sizeof(schedule_transition_t));
+    }
+    if (err == ESP_OK) err = nvs_commit(handle);
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t app_schedule_init()
+{
+    setenv("TZ", CONFIG_HEATER_SCHEDULE_TZ, 1);
+    tzset();
+
+    // Brings the clock back after a power loss without waiting for a
+    // controller's SetUTCTime; keeps polling once an hour
+    if (CONFIG_HEATER_SCHEDULE_NTP_SERVER[0]) {
+        esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+        esp_sntp_setservername(0, CONFIG_HEATER_SCHEDULE_NTP_SERVER);
+        sntp_set_time_sync_notification_cb(sntp_sync_cb);
+        esp_sntp_init();
+    }
+
+    std::lock_guard<std::mutex> lock(s_lock);
+    nvs_handle_t handle;
+    if (nvs_open(SCHEDULE_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        schedule_transition_t table[SCHEDULE_MAX_TRANSITIONS];
+        size_t len = sizeof(table);
+        if (nvs_get_blob(handle, SCHEDULE_KEY, table, &len) == ESP_OK) {
+            if (len % sizeof(table[0]) != 0 || !s_schedule.Load(table, len / sizeof(table[0]))) {
+                ESP_LOGW(TAG, "Stored schedule is corrupt, ignoring it");
+            }
+        }
+        nvs_close(handle);
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = schedule_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "schedule",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_timer);
+    if (err != ESP_OK) return err;
+
+    ESP_LOGI(TAG, "%d transition(s), TZ %s", s_schedule.Count(), CONFIG_HEATER_SCHEDULE_TZ);
+    arm_locked();
+    return ESP_OK;
+}
+
+esp_err_t app_schedule_set_days(uint8_t days, const schedule_transition_t *day_transitions, int count)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    if (!s_schedule.SetDays(days, day_transitions, count)) return ESP_ERR_INVALID_ARG;
+    s_applied_at = -1;
+    arm_locked();
+    return save_locked();
+}
+
+esp_err_t app_schedule_clear(uint8_t days)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_schedule.ClearDays(days);
+    s_applied_at = -1;
+    arm_locked();
+    return save_locked();
+}
+
+void app_schedule_get(app_schedule_info_t *info)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    info->count = s_schedule.Count();
+    memcpy(info->table, s_schedule.Table(), info->count * sizeof(info->table[0]));
+    info->clock_valid = local_minute_of_week(&info->now, &info->second);
+    info->next = -1;
+    if (info->clock_valid && info->count) {
+        info->next = (int)(s_schedule.Next(info->now) - s_schedule.Table());
+    }
+    info->applied = s_applied_count;
+}
+
+esp_err_t app_schedule_set_clock(int64_t unix_seconds)
+{
+    struct timeval tv = { .tv_sec = (time_t)unix_seconds, .tv_usec = 0 };
+    if (settimeofday(&tv, NULL) != 0) return ESP_FAIL;
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_applied_at = -1;
+    arm_locked();
+    return ESP_OK;
+}
+
+// --- MATTER (Thermostat SCH feature, Time Synchronization) ---
+// Heat is the only mode, so cool setpoints are ignored. A null heat setpoint
+// is an off transition: it is 0x8000 on the wire, the same as SCHEDULE_OFF.
+static Status set_weekly_schedule(const Thermostat::Commands::SetWeeklySchedule::DecodableType &req)
+{
+    uint8_t days = req.dayOfWeekForSequence.Raw() & SCHEDULE_ALL_DAYS;   // No Away schedule
+    if (!days || !req.modeForSequence.Has(Thermostat::ScheduleModeBitmap::kHeatSetpointPresent)) {
+        return Status::InvalidCommand;
+    }
+    if (req.numberOfTransitionsForSequence > SCHEDULE_DAILY_TRANSITIONS) return Status::ResourceExhausted;
+
+    schedule_transition_t day[SCHEDULE_DAILY_TRANSITIONS];
+    int count = 0;
+    auto it = req.transitions.begin();
+    while (it.Next()) {
+        const Transition::DecodableType &t = it.GetValue();
+        if (count == req.numberOfTransitionsForSequence) return Status::InvalidCommand;
+        if (t.transitionTime >= SCHEDULE_MINUTES_PER_DAY) return Status::ConstraintError;
+        int16_t setpoint = SCHEDULE_OFF;
+        if (!t.heatSetpoint.IsNull()) {
+            setpoint = t.heatSetpoint.Value();
+            if (setpoint < 500 || setpoint > 3500) return Status::ConstraintError;  // As on the console
+        }
+        day[count++] = { t.transitionTime, setpoint };
+    }
+    if (it.GetStatus() != CHIP_NO_ERROR || count != req.numberOfTransitionsForSequence) return Status::InvalidCommand;
+
+    // Repeated times are refused the same way as a full table
+    esp_err_t err = app_schedule_set_days(days, day, count);
+    if (err == ESP_ERR_INVALID_ARG) return Status::ResourceExhausted;
+    return err == ESP_OK ? Status::Success : Status::Failure;
+}
+
+static esp_err_t set_weekly_schedule_cb(const ConcreteCommandPath &path, chip::TLV::TLVReader &tlv, void *opaque_ptr)
+{
+    Thermostat::Commands::SetWeeklySchedule::DecodableType req;
+    Status status = Status::InvalidCommand;
+    if (chip::app::DataModel::Decode(tlv, req) == CHIP_NO_ERROR) status = set_weekly_schedule(req);
+    ((CommandHandler *)opaque_ptr)->AddStatus(path, status);
+    return ESP_OK;
+}
+
+// Answers for the first day asked for, and names every other day asked for
+// that has the same transitions
+static esp_err_t get_weekly_schedule_cb(const ConcreteCommandPath &path, chip::TLV::TLVReader &tlv, void *opaque_ptr)
+{
+    CommandHandler *handler = (CommandHandler *)opaque_ptr;
+    Thermostat::Commands::GetWeeklySchedule::DecodableType req;
+    uint8_t days = 0;
+    if (chip::app::DataModel::Decode(tlv, req) == CHIP_NO_ERROR) days = req.daysToReturn.Raw() & SCHEDULE_ALL_DAYS;
+    if (!days) {
+        handler->AddStatus(path, Status::InvalidCommand);
+        return ESP_OK;
+    }
+
+    // Matter thread only, and too big for its stack
+    static schedule_transition_t first[SCHEDULE_MAX_TRANSITIONS], other[SCHEDULE_MAX_TRANSITIONS];
+    static Transition::Type transitions[SCHEDULE_MAX_TRANSITIONS];
+    int first_day = __builtin_ctz(days);
+    uint8_t sequence_days = 1u << first_day;
+    int count;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        count = s_schedule.GetDay(first_day, first);
+        for (int d = first_day + 1; d < SCHEDULE_DAYS; d++) {
+            if (!(days & (1u << d))) continue;
+            if (s_schedule.GetDay(d, other) == count && memcmp(first, other, count * sizeof(first[0])) == 0) {
+                sequence_days |= 1u << d;
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        transitions[i].transitionTime = first[i].minute;
+        if (first[i].setpoint == SCHEDULE_OFF) transitions[i].heatSetpoint.SetNull();
+        else transitions[i].heatSetpoint.SetNonNull(first[i].setpoint);
+        transitions[i].coolSetpoint.SetNull();
+    }
+
+    Thermostat::Commands::GetWeeklyScheduleResponse::Type resp;
+    resp.numberOfTransitionsForSequence = (uint8_t)count;
+    resp.dayOfWeekForSequence = chip::BitMask<Thermostat::ScheduleDayOfWeekBitmap>(sequence_days);
+    resp.modeForSequence = chip::BitMask<Thermostat::ScheduleModeBitmap>(Thermostat::ScheduleModeBitmap::kHeatSetpointPresent);
+    resp.transitions = chip::app::DataModel::List<const Transition::Type>(transitions, count);
+    handler->AddResponse(path, resp);
+    return ESP_OK;
+}
+
+static esp_err_t clear_weekly_schedule_cb(const ConcreteCommandPath &path, chip::TLV::TLVReader &tlv, void *opaque_ptr)
+{
+    esp_err_t err = app_schedule_clear(SCHEDULE_ALL_DAYS);
+    ((CommandHandler *)opaque_ptr)->AddStatus(path, err == ESP_OK ? Status::Success : Status::Failure);
+    return ESP_OK;
+}
+
+esp_err_t app_schedule_create_clusters(node_t *node)
+{
+    // Lets the commissioner set the clock (SetUTCTime); SNTP keeps it after that
+    endpoint_t *root = endpoint::get(node, 0);
+    if (!cluster::get(root, TimeSynchronization::Id)) {
+        cluster::time_synchronization::config_t time_config;
+        if (!cluster::time_synchronization::create(root, &time_config, CLUSTER_FLAG_SERVER)) {
+            ESP_LOGE(TAG, "Failed to create time synchronization cluster");
+            return ESP_FAIL;
+        }
+    }
+
+    cluster_t *cluster = cluster::get(endpoint::get(node, thermostat_endpoint_id), Thermostat::Id);
+    if (!cluster) return ESP_ERR_INVALID_STATE;
+    attribute::create(cluster, Thermostat::Attributes::NumberOfWeeklyTransitions::Id, ATTRIBUTE_FLAG_NONE,
+                      esp_matter_uint8(SCHEDULE_MAX_TRANSITIONS));
+    attribute::create(cluster, Thermostat::Attributes::NumberOfDailyTransitions::Id, ATTRIBUTE_FLAG_NONE,
+                      esp_matter_uint8(SCHEDULE_DAILY_TRANSITIONS));
+    command::create(cluster, Thermostat::Commands::SetWeeklySchedule::Id, COMMAND_FLAG_ACCEPTED, set_weekly_schedule_cb);
+    command::create(cluster, Thermostat::Commands::GetWeeklySchedule::Id, COMMAND_FLAG_ACCEPTED, get_weekly_schedule_cb);
+    command::create(cluster, Thermostat::Commands::ClearWeeklySchedule::Id, COMMAND_FLAG_ACCEPTED, clear_weekly_schedule_cb);
+    command::create(cluster, Thermostat::Commands::GetWeeklyScheduleResponse::Id, COMMAND_FLAG_GENERATED, NULL);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t app_schedule_create_clusters(esp_matter::node_t *node) { return ESP_OK; }
+esp_err_t app_schedule_init() { return ESP_OK; }
+
+#endif // CONFIG_HEATER_SCHEDULE
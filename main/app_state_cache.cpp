@@ -0,0 +1,176 @@
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_system.h>
+#include <nvs.h>
+#include <string.h>
+#include <mutex>
+#include <app_priv.h>
+
+static const char *TAG = "STATE_CACHE";
+
+#define STATE_CACHE_NAMESPACE "heater"
+#define STATE_CACHE_KEY       "state"
+#define STATE_CACHE_VERSION   1
+
+#define STATE_CACHE_QUIET_US  ((int64_t)CONFIG_HEATER_STATE_PERSIST_QUIET_S * 1000000)
+#define STATE_CACHE_MAX_US    ((int64_t)CONFIG_HEATER_STATE_PERSIST_MAX_S * 1000000)
+
+// On-flash layout; independent of heater_state_t so the struct can evolve
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t power;
+    uint8_t mode;
+    uint8_t screen_on;
+    int16_t target_temp;
+    int16_t current_temp;
+} persisted_state_t;
+
+// RAM copy of the heater state. Updates only mark it dirty; one NVS blob is
+// written once the state has been quiet for a while (or has been dirty for
+// too long, or the system is restarting), and only if it differs from flash.
+static std::mutex s_lock;
+static persisted_state_t s_cached;
+static persisted_state_t s_committed;
+static bool s_dirty = false;
+static int64_t s_dirty_since_us = 0;
+static esp_timer_handle_t s_commit_timer = nullptr;
+static uint32_t s_commits = 0;
+static uint32_t s_skipped = 0;
+
+static persisted_state_t to_persisted(const heater_state_t *state)
+{
+    persisted_state_t p = {};
+    p.version = STATE_CACHE_VERSION;
+    p.power = state->power;
+    p.mode = state->mode;
+    p.screen_on = state->screen_on;
+    p.target_temp = (int16_t)state->target_temp;
+    p.current_temp = (int16_t)state->current_temp;
+    return p;
+}
+
+// force: also write a state that only differs by the room temperature
+static void commit(bool force)
+{
+    persisted_state_t snapshot;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        if (!s_dirty && !force) return;
+        s_dirty = false;
+        if (memcmp(&s_cached, &s_committed, sizeof(s_cached)) == 0) {
+            s_skipped++;
+            return;
+        }
+        snapshot = s_cached;
+    }
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(STATE_CACHE_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, STATE_CACHE_KEY, &snapshot, sizeof(snapshot));
+        if (err == ESP_OK) err = nvs_commit(handle);
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Commit failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_committed = snapshot;
+    s_commits++;
+    ESP_LOGD(TAG, "Heater state committed (%lu so far)", (unsigned long)s_commits);
+}
+
+static void commit_timer_cb(void *arg)
+{
+    commit(false);
+}
+
+// Restart hook (OTA, factory reset, console "reboot"): don't lose the tail
+static void on_shutdown()
+{
+    commit(true);
+}
+
+esp_err_t app_state_cache_init(heater_state_t *restored, bool *found)
+{
+    *found = false;
+    memset(&s_committed, 0, sizeof(s_committed));
+
+    nvs_handle_t handle;
+    if (nvs_open(STATE_CACHE_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        persisted_state_t p;
+        size_t len = sizeof(p);
+        if (nvs_get_blob(handle, STATE_CACHE_KEY, &p, &len) == ESP_OK && len == sizeof(p) &&
+            p.version == STATE_CACHE_VERSION) {
+            restored->power = p.power != 0;
+            restored->mode = p.mode;
+            restored->screen_on = p.screen_on != 0;
+            restored->target_temp = p.target_temp;
+            restored->current_temp = p.current_temp;
+            s_committed = p;
+            *found = true;
+        }
+        nvs_close(handle);
+    }
+    s_cached = s_committed;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = commit_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "state_commit",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_commit_timer);
+    if (err != ESP_OK) return err;
+    esp_register_shutdown_handler(on_shutdown);
+
+    if (*found) {
+        ESP_LOGI(TAG, "Restored heater state: power %d, target %d, mode %d, screen %d, room %d",
+                 restored->power, restored->target_temp, restored->mode, restored->screen_on, restored->current_temp);
+    }
+    return ESP_OK;
+}
+
+void app_state_cache_update(const heater_state_t *state)
+{
+    persisted_state_t next = to_persisted(state);
+    int64_t now = esp_timer_get_time();
+    int64_t delay_us;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        // The room temperature alone is not worth a flash write: it rides
+        // along with the next real change (or the restart flush)
+        persisted_state_t prev = s_cached;
+        s_cached = next;
+        prev.current_temp = next.current_temp;
+        if (memcmp(&prev, &next, sizeof(next)) == 0 && !s_dirty) return;
+
+        if (!s_dirty) {
+            s_dirty = true;
+            s_dirty_since_us = now;
+        }
+        // Every change restarts the quiet period, bounded by the max delay
+        delay_us = STATE_CACHE_QUIET_US;
+        int64_t deadline = s_dirty_since_us + STATE_CACHE_MAX_US;
+        if (now + delay_us > deadline) delay_us = deadline > now ? deadline - now : 0;
+    }
+    if (!s_commit_timer) return;
+    esp_timer_stop(s_commit_timer);
+    esp_timer_start_once(s_commit_timer, delay_us);
+}
+
+void app_state_cache_flush()
+{
+    if (s_commit_timer) esp_timer_stop(s_commit_timer);
+    commit(true);
+}
+
+void app_state_cache_get_stats(uint32_t *commits, uint32_t *skipped)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    *commits = s_commits;
+    *skipped = s_skipped;
+}
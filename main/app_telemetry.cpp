@@ -0,0 +1,199 @@
+#include <app_priv.h>
+#include <esp_log.h>
+
+#if CONFIG_HEATER_TELEMETRY
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include <time.h>
+#include <mutex>
+
+static const char *TAG = "APP_TELEMETRY";
+
+#define TELEMETRY_PERIOD_US     ((int64_t)CONFIG_HEATER_TELEMETRY_PERIOD_S * 1000000)
+#define TELEMETRY_CLOCK_VALID_S 1704067200  // 2024-01-01
+
+// Spill target: a raw data partition written as a ring of blocks
+#define TELEMETRY_PARTITION     "telemetry"
+#define TELEMETRY_SECTOR_SIZE   4096
+
+static std::mutex s_lock;
+static uint8_t s_ring[CONFIG_HEATER_TELEMETRY_RAM_KB * 1024];
+static TelemetryLog s_log(s_ring, sizeof(s_ring), CONFIG_HEATER_TELEMETRY_PERIOD_S);
+static esp_timer_handle_t s_sample_timer = nullptr;
+
+// Heating time within the current period, fed from the poll task
+static bool s_have_state = false;
+static bool s_heating = false;
+static int64_t s_heating_since_us = 0;
+static int64_t s_heating_us = 0;
+static int64_t s_period_start_us = 0;
+
+static const esp_partition_t *s_partition = nullptr;
+static uint32_t s_flash_slots = 0;
+static uint32_t s_flash_next = 0;
+static uint32_t s_flash_written = 0;
+
+// --- FLASH SPILL ---
+// Caller holds s_lock (called from Append)
+static void spill_block(const uint8_t *block, void *ctx)
+{
+    uint32_t offset = s_flash_next * TELEMETRY_BLOCK_SIZE;
+    if (offset % TELEMETRY_SECTOR_SIZE == 0) {
+        // Reclaims the oldest sector; its blocks are history now
+        if (esp_partition_erase_range(s_partition, offset, TELEMETRY_SECTOR_SIZE) != ESP_OK) return;
+    }
+    if (esp_partition_write(s_partition, offset, block, TELEMETRY_BLOCK_SIZE) != ESP_OK) {
+        ESP_LOGW(TAG, "Spill to flash failed");
+        return;
+    }
+    s_flash_next = (s_flash_next + 1) % s_flash_slots;
+    s_flash_written++;
+}
+
+// Finds where the previous boot stopped writing; blank slots read as 0xFF
+static void open_flash_ring()
+{
+    s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, TELEMETRY_PARTITION);
+    if (!s_partition) {
+        ESP_LOGW(TAG, "No '%s' partition, history stays in RAM", TELEMETRY_PARTITION);
+        return;
+    }
+    s_flash_slots = s_partition->size / TELEMETRY_SECTOR_SIZE * (TELEMETRY_SECTOR_SIZE / TELEMETRY_BLOCK_SIZE);
+    if (s_flash_slots == 0) {
+        s_partition = nullptr;
+        return;
+    }
+
+    bool found = false;
+    uint32_t newest = 0;
+    for (uint32_t slot = 0; slot < s_flash_slots; slot++) {
+        uint8_t header[8];         // Up to the used-bytes field
+        uint32_t seq;
+        if (esp_partition_read(s_partition, slot * TELEMETRY_BLOCK_SIZE, header, sizeof(header)) != ESP_OK) continue;
+        if (!TelemetryLog::BlockSeq(header, &seq)) continue;
+        if (!found || (int32_t)(seq - newest) > 0) {
+            found = true;
+            newest = seq;
+            s_flash_next = (slot + 1) % s_flash_slots;
+        }
+    }
+    if (found) s_log.SetNextSeq(newest + 1);
+    s_log.SetSpill(spill_block, nullptr);
+    ESP_LOGI(TAG, "Flash ring: %lu blocks, next slot %lu", (unsigned long)s_flash_slots, (unsigned long)s_flash_next);
+}
+
+// --- SAMPLING ---
+static void sample_timer_cb(void *arg)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    int64_t now = esp_timer_get_time();
+    int64_t heating = s_heating_us + (s_heating ? now - s_heating_since_us : 0);
+    int64_t period = now - s_period_start_us;
+    s_heating_us = 0;
+    s_heating_since_us = now;
+    s_period_start_us = now;
+    if (!s_have_state) return;
+
+    heater_state_t state = app_driver_get_state();
+    time_t wall = time(NULL);
+
+    telemetry_sample_t sample;
+    sample.wall_clock = wall >= TELEMETRY_CLOCK_VALID_S;
+    sample.time = sample.wall_clock ? (uint32_t)wall : (uint32_t)(now / 1000000);
+    sample.current_temp = (int8_t)state.current_temp;
+    sample.target_temp = (int8_t)state.target_temp;
+    sample.power = state.power;
+    sample.mode = state.mode;
+    sample.duty = period > 0 ? (uint8_t)(heating * 100 / period) : 0;
+    s_log.Append(sample);
+}
+
+esp_err_t app_telemetry_init()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+#if CONFIG_HEATER_TELEMETRY_FLASH
+        open_flash_ring();
+#endif
+        s_period_start_us = esp_timer_get_time();
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "telemetry",
+        .skip_unhandled_events = true,
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &s_sample_timer);
+    if (err != ESP_OK) return err;
+    return esp_timer_start_periodic(s_sample_timer, TELEMETRY_PERIOD_US);
+}
+
+void app_telemetry_update(bool heating)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    s_have_state = true;
+    if (heating == s_heating) return;
+    int64_t now = esp_timer_get_time();
+    if (s_heating) s_heating_us += now - s_heating_since_us;
+    s_heating = heating;
+    s_heating_since_us = now;
+}
+
+// --- EXPORT ---
+// Oldest first: spilled blocks the RAM ring no longer holds, then the ring.
+// One block at a time on the stack; the lock is only held for the copy.
+void app_telemetry_export(bool include_flash, telemetry_visit_cb_t visit, void *ctx)
+{
+    uint8_t block[TELEMETRY_BLOCK_SIZE];
+    uint32_t ram_oldest;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        ram_oldest = s_log.OldestSeq();
+    }
+
+    if (include_flash && s_partition) {
+        for (uint32_t i = 0; i < s_flash_slots; i++) {
+            esp_err_t err;
+            {
+                std::lock_guard<std::mutex> lock(s_lock);
+                uint32_t slot = (s_flash_next + i) % s_flash_slots;
+                err = esp_partition_read(s_partition, slot * TELEMETRY_BLOCK_SIZE, block, sizeof(block));
+            }
+            uint32_t seq;
+            if (err != ESP_OK || !TelemetryLog::BlockSeq(block, &seq)) continue;
+            if ((int32_t)(seq - ram_oldest) >= 0) continue; // Still in RAM
+            TelemetryLog::DecodeBlock(block, visit, ctx);
+        }
+    }
+
+    // Walk by sequence number: blocks dropped meanwhile shift the ring
+    for (uint32_t seq = ram_oldest;; seq++) {
+        {
+            std::lock_guard<std::mutex> lock(s_lock);
+            uint32_t oldest = s_log.OldestSeq();
+            if ((int32_t)(seq - oldest) < 0) seq = oldest;
+            if ((int)(seq - oldest) >= s_log.BlockCount()) break;
+            s_log.CopyBlock((int)(seq - oldest), block);
+        }
+        TelemetryLog::DecodeBlock(block, visit, ctx);
+    }
+}
+
+void app_telemetry_get_stats(app_telemetry_stats_t *stats)
+{
+    std::lock_guard<std::mutex> lock(s_lock);
+    stats->samples = s_log.Samples();
+    stats->bytes_used = s_log.BytesUsed();
+    stats->capacity = s_log.Capacity();
+    stats->flash_blocks = s_flash_slots;
+    stats->flash_written = s_flash_written;
+}
+
+#else
+
+esp_err_t app_telemetry_init() { return ESP_OK; }
+void app_telemetry_update(bool heating) {}
+
+#endif // CONFIG_HEATER_TELEMETRY
@@ -0,0 +1,51 @@
+#include "energy_meter.h"
+#include "tuya_driver.h"
+
+EnergyMeter::EnergyMeter(uint16_t high_w, uint16_t low_w, uint16_t eco_w) {
+    m_mode_w[MODE_HIGH] = high_w;
+    m_mode_w[MODE_LOW] = low_w;
+    m_mode_w[MODE_ECO] = eco_w;
+    m_watts = 0;
+    m_closed_mj = 0;
+    m_segment_ms = 0;
+    m_start_ms = 0;
+    m_heating_ms = 0;
+}
+
+void EnergyMeter::Restore(uint64_t energy_mj, int64_t now_ms) {
+    m_closed_mj = energy_mj;
+    m_segment_ms = now_ms;
+    m_start_ms = now_ms;
+    m_heating_ms = 0;
+}
+
+void EnergyMeter::Update(bool heating, uint8_t mode, int64_t now_ms) {
+    uint16_t watts = (heating && mode <= MODE_ECO) ? m_mode_w[mode] : 0;
+    if (watts == m_watts) return;
+
+    int64_t elapsed = now_ms - m_segment_ms;
+    if (elapsed > 0) {
+        m_closed_mj += (uint64_t)m_watts * (uint64_t)elapsed;
+        if (m_watts) m_heating_ms += elapsed;
+    }
+    m_watts = watts;
+    m_segment_ms = now_ms;
+}
+
+uint64_t EnergyMeter::EnergyMj(int64_t now_ms) const {
+    int64_t elapsed = now_ms - m_segment_ms;
+    return m_closed_mj + (elapsed > 0 ? (uint64_t)m_watts * (uint64_t)elapsed : 0);
+}
+
+uint32_t EnergyMeter::DutyPermille(int64_t now_ms) const {
+    int64_t total = now_ms - m_start_ms;
+    if (total <= 0) return 0;
+    int64_t heating = m_heating_ms;
+    if (m_watts && now_ms > m_segment_ms) heating += now_ms - m_segment_ms;
+    return (uint32_t)(heating * 1000 / total);
+}
+
+bool EnergyMeter::PersistDue(uint64_t energy_mj, uint64_t persisted_mj, uint64_t threshold_mj, bool force) {
+    if (energy_mj == persisted_mj) return false;
+    return force || energy_mj - persisted_mj >= threshold_mj;
+}
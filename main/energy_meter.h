@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+
+// Energy of a heater whose draw is known per mode, integrated piecewise.
+//
+// The draw only changes when the MCU reports a new state, so every Update()
+// closes the running segment at the old draw and starts a new one: O(1) per
+// state change, nothing per tick. Readers extrapolate the open segment to
+// "now". Plain data, so a copy can be published through a SeqLock.
+class EnergyMeter {
+public:
+    // Draw in W for MODE_HIGH, MODE_LOW and MODE_ECO
+    EnergyMeter(uint16_t high_w, uint16_t low_w, uint16_t eco_w);
+
+    // Continue from a persisted total; the current segment starts at now_ms
+    void Restore(uint64_t energy_mj, int64_t now_ms);
+
+    // The element started, stopped or changed mode
+    void Update(bool heating, uint8_t mode, int64_t now_ms);
+
+    uint64_t EnergyMj(int64_t now_ms) const;
+    uint16_t Watts() const { return m_watts; }
+
+    // Share of time spent heating since Restore(), in 1/1000
+    uint32_t DutyPermille(int64_t now_ms) const;
+
+    // A total is worth a flash write once it has moved threshold_mj past the
+    // persisted one, or on force (restart) as soon as it moved at all
+    static bool PersistDue(uint64_t energy_mj, uint64_t persisted_mj, uint64_t threshold_mj, bool force);
+
+private:
+    uint16_t m_mode_w[3];
+    uint16_t m_watts;           // Draw of the open segment
+    uint64_t m_closed_mj;       // Energy of all closed segments (W * ms)
+    int64_t m_segment_ms;       // Start of the open segment
+    int64_t m_start_ms;
+    int64_t m_heating_ms;       // Closed segments with a draw
+};
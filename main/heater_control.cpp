@@ -0,0 +1,187 @@
+#include "heater_control.h"
+#include <esp_log.h>
+
+static const char *TAG = "HEATER_CTRL";
+
+static const char *stage_name(heater_stage_t stage) {
+    static const char *names[] = { "OFF", "ECO", "LOW", "HIGH" };
+    return names[stage];
+}
+
+HeaterController::HeaterController(TuyaHeaterDriver *driver, uint32_t min_dwell_ms, uint32_t integral_time_s)
+    : m_enabled(HEATER_CTRL_UNSET), m_setpoint(HEATER_CTRL_SETPOINT_UNSET), m_stage(HEATER_STAGE_OFF) {
+    m_driver = driver;
+    m_min_dwell_ms = min_dwell_ms;
+    m_integral_time_s = integral_time_s ? integral_time_s : 1;
+
+    m_primed = false;
+    m_applied_enabled = false;
+    m_was_synced = false;
+    m_commanded = false;
+    m_last_target_temp = 0;
+    m_integral_sum = 0;
+    m_last_update_ms = 0;
+    m_stage_since_ms = 0;
+    m_commanded_ms = 0;
+}
+
+void HeaterController::SetEnabled(bool on) {
+    m_enabled.store(on ? 1 : 0, std::memory_order_relaxed);
+}
+
+void HeaterController::SetSetpoint(int16_t setpoint) {
+    m_setpoint.store(setpoint, std::memory_order_relaxed);
+}
+
+bool HeaterController::Realized(heater_stage_t stage, const heater_state_t &state) {
+    switch (stage) {
+    case HEATER_STAGE_OFF:  return !state.power;
+    case HEATER_STAGE_ECO:  return state.power && state.mode == MODE_ECO;
+    case HEATER_STAGE_LOW:  return state.power && state.mode == MODE_LOW;
+    case HEATER_STAGE_HIGH: return state.power && state.mode == MODE_HIGH;
+    }
+    return false;
+}
+
+heater_stage_t HeaterController::CurrentStage(const heater_state_t &state) {
+    heater_stage_t stage = HEATER_STAGE_OFF;
+    for (int s = HEATER_STAGE_ECO; s <= HEATER_STAGE_HIGH; s++) {
+        if (Realized((heater_stage_t)s, state)) stage = (heater_stage_t)s;
+    }
+    return stage;
+}
+
+heater_stage_t HeaterController::PickStage(int32_t output, heater_stage_t current) const {
+    static const int32_t above[] = { 0, HEATER_STAGE_ECO_ABOVE, HEATER_STAGE_LOW_ABOVE, HEATER_STAGE_HIGH_ABOVE };
+
+    int stage = HEATER_STAGE_OFF;
+    for (int s = HEATER_STAGE_ECO; s <= HEATER_STAGE_HIGH; s++) {
+        int32_t threshold = above[s] + (s > current ? HEATER_STAGE_MARGIN : -HEATER_STAGE_MARGIN);
+        if (output > threshold) stage = s;
+    }
+    return (heater_stage_t)stage;
+}
+
+void HeaterController::Apply(heater_stage_t stage, const heater_state_t &state, uint32_t now_ms) {
+    m_commanded_ms = now_ms;
+    m_commanded = true;
+    switch (stage) {
+    case HEATER_STAGE_OFF:
+        m_driver->SetPower(false);
+        break;
+    case HEATER_STAGE_ECO:
+    case HEATER_STAGE_LOW:
+    case HEATER_STAGE_HIGH: {
+        uint8_t mode = (stage == HEATER_STAGE_HIGH) ? MODE_HIGH : (stage == HEATER_STAGE_LOW) ? MODE_LOW : MODE_ECO;
+        if (state.power) {
+            m_driver->SetMode(mode);
+        } else {
+            m_driver->SetPowerAndMode(true, mode);
+        }
+        break;
+    }
+    }
+}
+
+void HeaterController::Update(const heater_state_t &state, uint32_t now_ms) {
+    if (!m_driver->IsSynced()) {
+        m_was_synced = false;
+        return;
+    }
+    if (!m_was_synced) {
+        // Fresh handshake (boot or MCU restart): the MCU reports its own
+        // power-up state, which says nothing about what anyone wanted
+        m_was_synced = true;
+        m_commanded = false;
+    }
+
+    heater_stage_t stage = GetStage();
+    if (!m_primed) {
+        // Start from whatever the heater is doing right now, unless a
+        // controller has already said what it wants
+        int8_t unset_enabled = HEATER_CTRL_UNSET;
+        m_enabled.compare_exchange_strong(unset_enabled, state.power ? 1 : 0, std::memory_order_relaxed);
+        int16_t unset_setpoint = HEATER_CTRL_SETPOINT_UNSET;
+        m_setpoint.compare_exchange_strong(unset_setpoint, (int16_t)(state.target_temp * 100),
+                                           std::memory_order_relaxed);
+        m_applied_enabled = state.power;
+        stage = CurrentStage(state);
+        m_stage.store(stage, std::memory_order_relaxed);
+        m_last_target_temp = state.target_temp;
+        m_last_update_ms = now_ms;
+        m_stage_since_ms = now_ms;
+        m_commanded_ms = now_ms;
+        m_primed = true;
+    }
+
+    // Setpoint changed on the heater's own keys. The MCU only knows whole
+    // degrees, so an echo of our own fractional setpoint is not a change.
+    if (state.target_temp != m_last_target_temp) {
+        m_last_target_temp = state.target_temp;
+        if (state.target_temp != m_setpoint.load(std::memory_order_relaxed) / 100) {
+            m_setpoint.store((int16_t)(state.target_temp * 100), std::memory_order_relaxed);
+        }
+    }
+
+    // Power switched on the heater itself: follow it instead of fighting it.
+    // Only once we have commanded it since the sync; before that a mismatch
+    // is the MCU coming back from a power cut, not a person.
+    bool stage_on = (stage != HEATER_STAGE_OFF);
+    if (state.power != stage_on && m_commanded && now_ms - m_commanded_ms >= HEATER_CTRL_OVERRIDE_MS) {
+        ESP_LOGI(TAG, "Heater switched %s locally, control %s", state.power ? "on" : "off",
+                 state.power ? "enabled" : "disabled");
+        m_enabled.store(state.power ? 1 : 0, std::memory_order_relaxed);
+        m_applied_enabled = !state.power; // Force the enable edge below
+    }
+
+    bool enabled = IsEnabled();
+    if (enabled != m_applied_enabled) {
+        m_applied_enabled = enabled;
+        m_integral_sum = 0;
+        m_stage_since_ms = now_ms - m_min_dwell_ms; // React to the switch right away
+        if (!enabled) {
+            // SystemMode Off: the Matter write path has already sent power off
+            m_stage.store(HEATER_STAGE_OFF, std::memory_order_relaxed);
+            m_last_update_ms = now_ms;
+            return;
+        }
+        // Pick up the actual stage so the first decision starts from reality
+        stage = CurrentStage(state);
+        m_stage.store(stage, std::memory_order_relaxed);
+    }
+    if (!enabled) {
+        m_last_update_ms = now_ms;
+        return;
+    }
+
+    // PI on the room temperature, integral clamped against wind-up. The sum
+    // is kept undivided so small errors over short steps still add up.
+    int32_t error = (int32_t)m_setpoint.load(std::memory_order_relaxed) - state.current_temp * 100;
+    uint32_t dt_s = (now_ms - m_last_update_ms) / 1000;
+    if (dt_s > 0) {
+        int64_t sum_max = (int64_t)HEATER_CTRL_INTEGRAL_MAX * m_integral_time_s;
+        m_integral_sum += (int64_t)error * dt_s;
+        if (m_integral_sum > sum_max) m_integral_sum = sum_max;
+        if (m_integral_sum < -sum_max) m_integral_sum = -sum_max;
+        m_last_update_ms += dt_s * 1000;
+    }
+    int32_t integral = (int32_t)(m_integral_sum / m_integral_time_s);
+
+    heater_stage_t wanted = PickStage(error + integral, stage);
+    if (wanted != stage && now_ms - m_stage_since_ms >= m_min_dwell_ms) {
+        ESP_LOGI(TAG, "%s -> %s (error %ld, integral %ld)", stage_name(stage), stage_name(wanted),
+                 (long)error, (long)integral);
+        stage = wanted;
+        m_stage.store(stage, std::memory_order_relaxed);
+        m_stage_since_ms = now_ms;
+        Apply(stage, state, now_ms);
+        return;
+    }
+
+    // Re-assert a stage the MCU did not take (command lost after retries),
+    // or one it lost by restarting
+    if (!Realized(stage, state) && now_ms - m_commanded_ms >= HEATER_CTRL_OVERRIDE_MS &&
+        (state.power == stage_on || !m_commanded)) {
+        Apply(stage, state, now_ms);
+    }
+}
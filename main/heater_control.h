@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include "tuya_driver.h"
+
+// Output stages the controller can put the heater in, lowest to highest
+typedef enum {
+    HEATER_STAGE_OFF,       // Element off (MCU power off, SystemMode stays Heat)
+    HEATER_STAGE_ECO,
+    HEATER_STAGE_LOW,
+    HEATER_STAGE_HIGH,
+} heater_stage_t;
+
+// PI output (0.01 °C) above which a stage is wanted; STAGE_UP_MARGIN is added
+// going up and subtracted going down, so a value sitting on a threshold can't
+// make the stage chatter
+#define HEATER_STAGE_ECO_ABOVE   (-50)
+#define HEATER_STAGE_LOW_ABOVE   50
+#define HEATER_STAGE_HIGH_ABOVE  150
+#define HEATER_STAGE_MARGIN      25
+
+// Integral clamp (0.01 °C of output) against wind-up while the heater is
+// already flat out or the room is warmer than wanted
+#define HEATER_CTRL_INTEGRAL_MAX 200
+
+// MCU state that disagrees with our last command for this long is a change
+// made on the heater itself (keys or remote): the controller follows it
+#define HEATER_CTRL_OVERRIDE_MS  5000
+
+// Enable and setpoint before anything wrote them or the first sync primed them
+#define HEATER_CTRL_UNSET          (-1)
+#define HEATER_CTRL_SETPOINT_UNSET INT16_MIN
+
+// Local closed-loop control on top of TuyaHeaterDriver.
+//
+// A PI term on (setpoint - room temperature) picks one of the stages above,
+// which is applied with SetPower/SetPowerAndMode/SetMode. It runs in the
+// task that calls Poll(), right after every MCU report, so the reaction does
+// not depend on the Thread network or a controller being reachable.
+class HeaterController {
+public:
+    HeaterController(TuyaHeaterDriver *driver, uint32_t min_dwell_ms, uint32_t integral_time_s);
+
+    // From any task (Matter writes). Takes effect on the next Update().
+    void SetEnabled(bool on);
+    void SetSetpoint(int16_t setpoint);     // 0.01 °C
+
+    bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed) == 1; }
+    heater_stage_t GetStage() const { return (heater_stage_t)m_stage.load(std::memory_order_relaxed); }
+
+    // Poll task only: after every Poll(). Does nothing until the driver is synced.
+    void Update(const heater_state_t &state, uint32_t now_ms);
+
+private:
+    TuyaHeaterDriver *m_driver;
+    uint32_t m_min_dwell_ms;
+    uint32_t m_integral_time_s;
+
+    // A value written before the first sync is kept; only unset ones are
+    // primed from the MCU's report
+    std::atomic<int8_t> m_enabled;
+    std::atomic<int16_t> m_setpoint;
+    std::atomic<uint8_t> m_stage;
+
+    // Poll task state
+    bool m_primed;              // Enable/setpoint adopted from the first synced state
+    bool m_applied_enabled;
+    bool m_was_synced;          // Driver was synced at the previous Update()
+    bool m_commanded;           // Apply() ran since the driver last (re)synced
+    int m_last_target_temp;
+    int64_t m_integral_sum;     // Sum of error * seconds (0.01 °C s); divided only for the output
+    uint32_t m_last_update_ms;
+    uint32_t m_stage_since_ms;
+    uint32_t m_commanded_ms;
+
+    heater_stage_t PickStage(int32_t output, heater_stage_t current) const;
+    void Apply(heater_stage_t stage, const heater_state_t &state, uint32_t now_ms);
+    static bool Realized(heater_stage_t stage, const heater_state_t &state);
+    static heater_stage_t CurrentStage(const heater_state_t &state);
+};
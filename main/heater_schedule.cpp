@@ -0,0 +1,101 @@
+#include "heater_schedule.h"
+#include <string.h>
+
+bool WeeklySchedule::SetDays(uint8_t days, const schedule_transition_t *day_transitions, int count) {
+    days &= SCHEDULE_ALL_DAYS;
+    uint32_t seen[SCHEDULE_MINUTES_PER_DAY / 32] = {};
+    for (int i = 0; i < count; i++) {
+        uint16_t m = day_transitions[i].minute;
+        if (m >= SCHEDULE_MINUTES_PER_DAY || (seen[m / 32] & (1u << (m % 32)))) return false;
+        seen[m / 32] |= 1u << (m % 32);
+    }
+
+    int kept = 0;
+    for (int i = 0; i < m_count; i++) {
+        if (!(days & (1u << (m_table[i].minute / SCHEDULE_MINUTES_PER_DAY)))) kept++;
+    }
+    if (kept + count * __builtin_popcount(days) > SCHEDULE_MAX_TRANSITIONS) return false;
+
+    // Merge in one pass per day: drop that day's entries, then insert the new
+    // ones at their sorted position
+    ClearDays(days);
+    for (int d = 0; d < SCHEDULE_DAYS; d++) {
+        if (!(days & (1u << d))) continue;
+        for (int i = 0; i < count; i++) {
+            schedule_transition_t t = { (uint16_t)(d * SCHEDULE_MINUTES_PER_DAY + day_transitions[i].minute),
+                                        day_transitions[i].setpoint };
+            int pos = UpperBound(t.minute);
+            memmove(&m_table[pos + 1], &m_table[pos], (m_count - pos) * sizeof(m_table[0]));
+            m_table[pos] = t;
+            m_count++;
+        }
+    }
+    return true;
+}
+
+void WeeklySchedule::ClearDays(uint8_t days) {
+    int out = 0;
+    for (int i = 0; i < m_count; i++) {
+        if (days & (1u << (m_table[i].minute / SCHEDULE_MINUTES_PER_DAY))) continue;
+        m_table[out++] = m_table[i];
+    }
+    m_count = out;
+}
+
+int WeeklySchedule::GetDay(int day, schedule_transition_t *out) const {
+    int count = 0;
+    int first = day > 0 ? UpperBound((uint16_t)(day * SCHEDULE_MINUTES_PER_DAY - 1)) : 0;
+    for (int i = first; i < m_count; i++) {
+        if (m_table[i].minute / SCHEDULE_MINUTES_PER_DAY != day) break;
+        out[count].minute = m_table[i].minute % SCHEDULE_MINUTES_PER_DAY;
+        out[count].setpoint = m_table[i].setpoint;
+        count++;
+    }
+    return count;
+}
+
+bool WeeklySchedule::Load(const schedule_transition_t *table, int count) {
+    if (count < 0 || count > SCHEDULE_MAX_TRANSITIONS) return false;
+    for (int i = 0; i < count; i++) {
+        if (table[i].minute >= SCHEDULE_MINUTES_PER_WEEK) return false;
+        if (i > 0 && table[i].minute <= table[i - 1].minute) return false;
+    }
+    memcpy(m_table, table, count * sizeof(m_table[0]));
+    m_count = count;
+    return true;
+}
+
+// Index of the first transition after now
+int WeeklySchedule::UpperBound(uint16_t now) const {
+    int lo = 0, hi = m_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (m_table[mid].minute <= now) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+const schedule_transition_t *WeeklySchedule::Next(uint16_t now) const {
+    if (m_count == 0) return nullptr;
+    int i = UpperBound(now);
+    return &m_table[i < m_count ? i : 0];
+}
+
+const schedule_transition_t *WeeklySchedule::Current(uint16_t now) const {
+    if (m_count == 0) return nullptr;
+    int i = UpperBound(now);
+    return &m_table[i > 0 ? i - 1 : m_count - 1];
+}
+
+uint16_t WeeklySchedule::MinutesUntil(uint16_t now, const schedule_transition_t *t) {
+    int diff = (int)t->minute - (int)now;
+    if (diff <= 0) diff += SCHEDULE_MINUTES_PER_WEEK;
+    return (uint16_t)diff;
+}
+
+uint16_t WeeklySchedule::MinutesSince(uint16_t now, const schedule_transition_t *t) {
+    int diff = (int)now - (int)t->minute;
+    if (diff < 0) diff += SCHEDULE_MINUTES_PER_WEEK;
+    return (uint16_t)diff;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+#define SCHEDULE_DAYS               7
+#define SCHEDULE_MINUTES_PER_DAY    (24 * 60)
+#define SCHEDULE_MINUTES_PER_WEEK   (SCHEDULE_DAYS * SCHEDULE_MINUTES_PER_DAY)
+#define SCHEDULE_MAX_TRANSITIONS    64
+
+// Setpoint of a transition that switches heating off
+#define SCHEDULE_OFF                INT16_MIN
+
+// Day bits as in the Thermostat cluster's ScheduleDayOfWeekBitmap
+#define SCHEDULE_SUNDAY             0x01
+#define SCHEDULE_ALL_DAYS           0x7F
+
+typedef struct {
+    uint16_t minute;        // Of the week, 0 = Sunday 00:00 local time
+    int16_t setpoint;       // 0.01 °C, or SCHEDULE_OFF
+} schedule_transition_t;
+
+// Weekly setpoint schedule as one flat table sorted by minute of the week.
+//
+// Edits work per day like SetWeeklySchedule does (all transitions of the
+// given days are replaced), but the table itself is precomputed: finding the
+// next or the active transition is a binary search, so one timer armed for
+// Next() is all it takes to run it. Not thread-safe; the owner locks.
+class WeeklySchedule {
+public:
+    WeeklySchedule() : m_count(0) {}
+
+    // Replace the transitions of every day in days. minute is the minute of
+    // the day here. Fails without changing anything if a minute is out of
+    // range or repeated, or the table would overflow.
+    bool SetDays(uint8_t days, const schedule_transition_t *day_transitions, int count);
+    void ClearDays(uint8_t days);
+
+    // Adopt a persisted table; rejected unless sorted and in range
+    bool Load(const schedule_transition_t *table, int count);
+
+    // Transitions of one day (0 = Sunday) with minute of the day, like
+    // GetWeeklySchedule returns them; out holds SCHEDULE_MAX_TRANSITIONS
+    int GetDay(int day, schedule_transition_t *out) const;
+
+    int Count() const { return m_count; }
+    const schedule_transition_t *Table() const { return m_table; }
+
+    // First transition strictly after now (wrapping into next week), or null
+    const schedule_transition_t *Next(uint16_t now) const;
+    // Transition in force at now: the last one at or before it, or null
+    const schedule_transition_t *Current(uint16_t now) const;
+
+    // Minutes from now until a transition fires, 1..SCHEDULE_MINUTES_PER_WEEK
+    static uint16_t MinutesUntil(uint16_t now, const schedule_transition_t *t);
+    // Minutes since it last fired, 0..SCHEDULE_MINUTES_PER_WEEK - 1
+    static uint16_t MinutesSince(uint16_t now, const schedule_transition_t *t);
+
+private:
+    schedule_transition_t m_table[SCHEDULE_MAX_TRANSITIONS];
+    int m_count;
+
+    int UpperBound(uint16_t now) const;
+};
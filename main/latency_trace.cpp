@@ -0,0 +1,173 @@
+#include "latency_trace.h"
+
+#if CONFIG_HEATER_LATENCY_TRACE
+
+#include <atomic>
+#include "tuya_driver.h"
+
+// Microsecond timestamps truncated to 32 bits: deltas stay correct across
+// the ~71 min wrap and loads/stores are single instructions on the C6.
+// 0 means "not reached yet".
+typedef struct {
+    std::atomic<uint32_t> at[LATENCY_STAGE_COUNT];
+} latency_slot_t;
+
+// Histogram resolution: 64 us units, 4 sub-buckets per power of two
+#define LAT_UNIT_SHIFT   6
+#define LAT_SUB_BITS     2
+#define LAT_SUB_BUCKETS  (1 << LAT_SUB_BITS)
+#define LAT_MAX_MSB      17   // 2^18 units ~ 16.7 s, beyond LATENCY_TRACE_EXPIRE_MS
+#define LAT_BUCKETS      (LAT_SUB_BUCKETS + (LAT_MAX_MSB - LAT_SUB_BITS + 1) * LAT_SUB_BUCKETS)
+
+typedef struct {
+    std::atomic<uint32_t> buckets[LAT_BUCKETS];
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> max_us;
+} latency_hist_t;
+
+static latency_slot_t s_slots[HeaterSchema::kCount];
+static latency_hist_t s_hist[LATENCY_SEGMENT_COUNT];
+static uint32_t s_pending_write = 0;    // Matter thread only
+
+static const char *k_segment_names[LATENCY_SEGMENT_COUNT] = {
+    "write -> driver",
+    "driver -> uart tx",
+    "uart tx -> echo",
+    "echo -> report",
+    "write -> report",
+};
+
+static inline uint32_t stamp(int64_t now_us)
+{
+    uint32_t t = (uint32_t)now_us;
+    return t ? t : 1;
+}
+
+static int bucket_index(uint32_t us)
+{
+    uint32_t v = us >> LAT_UNIT_SHIFT;
+    if (v < LAT_SUB_BUCKETS) return (int)v;
+
+    int msb = 31 - __builtin_clz(v);
+    if (msb > LAT_MAX_MSB) return LAT_BUCKETS - 1;
+    int sub = (int)((v >> (msb - LAT_SUB_BITS)) & (LAT_SUB_BUCKETS - 1));
+    return LAT_SUB_BUCKETS + (msb - LAT_SUB_BITS) * LAT_SUB_BUCKETS + sub;
+}
+
+static uint32_t bucket_upper_us(int idx)
+{
+    if (idx < LAT_SUB_BUCKETS) return (uint32_t)(idx + 1) << LAT_UNIT_SHIFT;
+
+    int msb = (idx - LAT_SUB_BUCKETS) / LAT_SUB_BUCKETS + LAT_SUB_BITS;
+    int sub = (idx - LAT_SUB_BUCKETS) % LAT_SUB_BUCKETS;
+    return ((uint32_t)(LAT_SUB_BUCKETS + sub + 1) << (msb - LAT_SUB_BITS)) << LAT_UNIT_SHIFT;
+}
+
+// Single writer (the Matter thread closes every trace)
+static void record(int segment, uint32_t us)
+{
+    latency_hist_t &h = s_hist[segment];
+    h.buckets[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+    h.count.fetch_add(1, std::memory_order_relaxed);
+    if (us > h.max_us.load(std::memory_order_relaxed)) h.max_us.store(us, std::memory_order_relaxed);
+}
+
+static void close_trace(latency_slot_t &slot, uint32_t now)
+{
+    uint32_t at[LATENCY_STAGE_COUNT];
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        at[i] = slot.at[i].exchange(0, std::memory_order_acq_rel);
+    }
+    at[LATENCY_STAGE_REPORT] = now;
+
+    // Stale: the write never produced a report of its own
+    if (now - at[LATENCY_STAGE_MATTER_WRITE] > LATENCY_TRACE_EXPIRE_MS * 1000u) return;
+
+    for (int i = 0; i + 1 < LATENCY_STAGE_COUNT; i++) {
+        if (at[i] && at[i + 1]) record(i, at[i + 1] - at[i]);
+    }
+    record(LATENCY_SEGMENT_TOTAL, now - at[LATENCY_STAGE_MATTER_WRITE]);
+}
+
+void latency_trace_write_received(int64_t now_us)
+{
+    s_pending_write = stamp(now_us);
+}
+
+void latency_trace_mark(uint8_t dp_id, latency_stage_t stage, int64_t now_us)
+{
+    int idx = HeaterSchema::IndexOf(dp_id);
+    if (idx < 0) return;
+    latency_slot_t &slot = s_slots[idx];
+    uint32_t now = stamp(now_us);
+
+    switch (stage) {
+    case LATENCY_STAGE_MATTER_WRITE:
+        break;
+
+    case LATENCY_STAGE_DRIVER:
+        // A newer write restarts the trace for this DP
+        for (int i = LATENCY_STAGE_REPORT; i > LATENCY_STAGE_MATTER_WRITE; i--) {
+            slot.at[i].store(0, std::memory_order_relaxed);
+        }
+        slot.at[LATENCY_STAGE_DRIVER].store(now, std::memory_order_relaxed);
+        slot.at[LATENCY_STAGE_MATTER_WRITE].store(s_pending_write ? s_pending_write : now, std::memory_order_release);
+        break;
+
+    case LATENCY_STAGE_UART_TX:
+    case LATENCY_STAGE_MCU_ECHO:
+        // First occurrence only: retries do not reset the clock
+        if (!slot.at[stage - 1].load(std::memory_order_acquire)) return;
+        if (slot.at[stage].load(std::memory_order_relaxed)) return;
+        slot.at[stage].store(now, std::memory_order_release);
+        break;
+
+    case LATENCY_STAGE_REPORT:
+        if (!slot.at[LATENCY_STAGE_MCU_ECHO].load(std::memory_order_acquire)) return;
+        close_trace(slot, now);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void latency_trace_get(int segment, latency_summary_t *summary)
+{
+    const latency_hist_t &h = s_hist[segment];
+    summary->count = h.count.load(std::memory_order_relaxed);
+    summary->max_us = h.max_us.load(std::memory_order_relaxed);
+    summary->p50_us = 0;
+    summary->p95_us = 0;
+    if (summary->count == 0) return;
+
+    uint32_t rank50 = (summary->count * 50 + 99) / 100;
+    uint32_t rank95 = (summary->count * 95 + 99) / 100;
+    uint32_t seen = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        seen += h.buckets[i].load(std::memory_order_relaxed);
+        uint32_t upper = bucket_upper_us(i);
+        if (upper > summary->max_us) upper = summary->max_us;
+        if (!summary->p50_us && seen >= rank50) summary->p50_us = upper;
+        if (!summary->p95_us && seen >= rank95) {
+            summary->p95_us = upper;
+            break;
+        }
+    }
+}
+
+const char *latency_trace_segment_name(int segment)
+{
+    return (segment >= 0 && segment < LATENCY_SEGMENT_COUNT) ? k_segment_names[segment] : "?";
+}
+
+void latency_trace_reset()
+{
+    for (auto &h : s_hist) {
+        for (auto &b : h.buckets) b.store(0, std::memory_order_relaxed);
+        h.count.store(0, std::memory_order_relaxed);
+        h.max_us.store(0, std::memory_order_relaxed);
+    }
+}
+
+#endif // CONFIG_HEATER_LATENCY_TRACE
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include "sdkconfig.h"
+
+// End-to-end write latency: Matter write -> driver -> UART -> MCU echo ->
+// Matter report. Each traced DP carries one in-flight trace; the time between
+// consecutive stages feeds a fixed-size log-linear histogram (no heap).
+typedef enum {
+    LATENCY_STAGE_MATTER_WRITE,     // PRE_UPDATE in app_attribute_update_cb
+    LATENCY_STAGE_DRIVER,           // app_driver_thermostat_set_value
+    LATENCY_STAGE_UART_TX,          // First 0x06 frame carrying the DP, queued for TX
+    LATENCY_STAGE_MCU_ECHO,         // 0x07 report confirming the DP
+    LATENCY_STAGE_REPORT,           // attribute::report of the new value
+    LATENCY_STAGE_COUNT,
+} latency_stage_t;
+
+// Histograms: stage i -> i+1 for every stage, plus write -> report
+#define LATENCY_SEGMENT_TOTAL   (LATENCY_STAGE_COUNT - 1)
+#define LATENCY_SEGMENT_COUNT   LATENCY_STAGE_COUNT
+
+// Traces not completed within this window are abandoned (e.g. a write that
+// did not change anything, so no report ever follows)
+#define LATENCY_TRACE_EXPIRE_MS 10000
+
+typedef struct {
+    uint32_t count;
+    uint32_t p50_us;    // Bucket upper bound, within ~25%
+    uint32_t p95_us;
+    uint32_t max_us;    // Exact
+} latency_summary_t;
+
+#if CONFIG_HEATER_LATENCY_TRACE
+
+// Matter thread: a write interaction reached the application
+void latency_trace_write_received(int64_t now_us);
+
+// Record a stage for dp_id. LATENCY_STAGE_DRIVER opens the trace (stamped with
+// the pending write), LATENCY_STAGE_REPORT closes it. Out-of-order or
+// untraced marks are ignored.
+void latency_trace_mark(uint8_t dp_id, latency_stage_t stage, int64_t now_us);
+
+void latency_trace_get(int segment, latency_summary_t *summary);
+const char *latency_trace_segment_name(int segment);
+void latency_trace_reset();
+
+#else
+
+static inline void latency_trace_write_received(int64_t now_us) {}
+static inline void latency_trace_mark(uint8_t dp_id, latency_stage_t stage, int64_t now_us) {}
+
+#endif
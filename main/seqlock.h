@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+
+// Single-writer sequence lock for small trivially copyable values.
+//
+// The writer never blocks: it bumps the sequence to odd, stores the payload
+// and bumps it back to even. Readers copy the payload and retry if the
+// sequence was odd or moved under them. The payload is held in relaxed
+// atomic words so the racing copy is well defined.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+    SeqLock() : m_seq(0) {
+        for (auto &w : m_words) w.store(0, std::memory_order_relaxed);
+    }
+
+    // Only ever call from one task at a time
+    void Store(const T &value) {
+        uint32_t buf[kWords] = {};
+        memcpy(buf, &value, sizeof(T));
+
+        uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; i++) m_words[i].store(buf[i], std::memory_order_relaxed);
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    T Load() const {
+        uint32_t buf[kWords];
+        for (int attempt = 0;; attempt++) {
+            uint32_t before = m_seq.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                for (size_t i = 0; i < kWords; i++) buf[i] = m_words[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_seq.load(std::memory_order_relaxed) == before) break;
+            }
+            // On a single core the writer can only finish if we step aside
+            if (attempt >= 3) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        T out;
+        memcpy(&out, buf, sizeof(T));
+        return out;
+    }
+
+    // Even number that changes on every Store()
+    uint32_t Sequence() const { return m_seq.load(std::memory_order_acquire) & ~1u; }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> m_seq;
+    std::atomic<uint32_t> m_words[kWords];
+};
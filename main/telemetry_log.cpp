@@ -0,0 +1,234 @@
+#include "telemetry_log.h"
+#include <string.h>
+
+// Block layout
+//   0      magic
+//   1..4   sequence number (LE)
+//   5..6   bytes used, header included (LE)
+//   7..10  time of the first sample (LE)
+//   11     period in seconds
+//   12     flags (bit 0: wall clock)
+//   13..16 first sample: current, target, state, duty
+//   17..   delta records
+#define HDR_SEQ         1
+#define HDR_USED        5
+#define HDR_TIME        7
+#define HDR_PERIOD      11
+#define HDR_FLAGS       12
+#define HDR_KEY         13
+#define HDR_SIZE        17
+
+#define FLAG_WALL_CLOCK 0x01
+
+// Delta record control byte: which fields follow
+#define REC_TIME        0x01    // varint periods since the last sample (else 1)
+#define REC_CURRENT     0x02    // zigzag varint delta
+#define REC_TARGET      0x04    // zigzag varint delta
+#define REC_STATE       0x08    // raw byte: power | mode << 1
+#define REC_DUTY        0x10    // raw byte
+#define REC_MAX_SIZE    (1 + 5 + 2 + 2 + 1 + 1)
+
+// Gaps longer than this (or clock steps) start a fresh keyframe
+#define MAX_GAP_PERIODS 1000
+
+static void put_u16(uint8_t *p, uint16_t v) { p[0] = v & 0xFF; p[1] = v >> 8; }
+static uint16_t get_u16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+static void put_u32(uint8_t *p, uint32_t v) { for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF; }
+static uint32_t get_u32(const uint8_t *p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+static int put_varint(uint8_t *p, uint32_t v) {
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+// Returns bytes consumed, 0 if it runs past end
+static int get_varint(const uint8_t *p, const uint8_t *end, uint32_t *v) {
+    *v = 0;
+    for (int n = 0; n < 5 && p + n < end; n++) {
+        *v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+        if (!(p[n] & 0x80)) return n + 1;
+    }
+    return 0;
+}
+
+static uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+static uint8_t pack_state(const telemetry_sample_t &s) { return (s.power ? 1 : 0) | (s.mode << 1); }
+
+TelemetryLog::TelemetryLog(uint8_t *storage, size_t size, uint8_t period_s) {
+    m_storage = storage;
+    m_blocks = (int)(size / TELEMETRY_BLOCK_SIZE);
+    m_period_s = period_s ? period_s : 1;
+    m_first = 0;
+    m_count = 0;
+    m_open = false;
+    m_next_seq = 0;
+    m_samples = 0;
+    memset(&m_last, 0, sizeof(m_last));
+    m_spill = nullptr;
+    m_spill_ctx = nullptr;
+}
+
+void TelemetryLog::SetSpill(telemetry_spill_cb_t spill, void *ctx) {
+    m_spill = spill;
+    m_spill_ctx = ctx;
+}
+
+void TelemetryLog::Seal() {
+    if (!m_open) return;
+    m_open = false;
+    if (m_spill) m_spill(Block(m_count - 1), m_spill_ctx);
+}
+
+void TelemetryLog::StartBlock(const telemetry_sample_t &sample) {
+    Seal();
+    if (m_count == m_blocks) {
+        m_first = (m_first + 1) % m_blocks;   // Drop the oldest block whole
+        m_count--;
+    }
+    m_count++;
+    uint8_t *b = Block(m_count - 1);
+    memset(b, 0, TELEMETRY_BLOCK_SIZE);
+    b[0] = TELEMETRY_BLOCK_MAGIC;
+    put_u32(b + HDR_SEQ, m_next_seq++);
+    put_u16(b + HDR_USED, HDR_SIZE);
+    put_u32(b + HDR_TIME, sample.time);
+    b[HDR_PERIOD] = m_period_s;
+    b[HDR_FLAGS] = sample.wall_clock ? FLAG_WALL_CLOCK : 0;
+    b[HDR_KEY + 0] = (uint8_t)sample.current_temp;
+    b[HDR_KEY + 1] = (uint8_t)sample.target_temp;
+    b[HDR_KEY + 2] = pack_state(sample);
+    b[HDR_KEY + 3] = sample.duty;
+    m_open = true;
+}
+
+void TelemetryLog::Append(const telemetry_sample_t &sample) {
+    if (m_blocks == 0) return;
+    m_samples++;
+
+    uint8_t *b = m_open ? Block(m_count - 1) : nullptr;
+    uint16_t used = b ? get_u16(b + HDR_USED) : 0;
+    uint32_t periods = 0;
+    if (b) {
+        uint32_t elapsed = sample.time - m_last.time;
+        periods = (elapsed + m_period_s / 2) / m_period_s;
+    }
+    if (!b || sample.wall_clock != m_last.wall_clock || sample.time < m_last.time || periods == 0 ||
+        periods > MAX_GAP_PERIODS || used + REC_MAX_SIZE > TELEMETRY_BLOCK_SIZE) {
+        StartBlock(sample);
+        m_last = sample;
+        return;
+    }
+
+    uint8_t rec[REC_MAX_SIZE];
+    uint8_t ctrl = 0;
+    int n = 1;
+    if (periods != 1) {
+        ctrl |= REC_TIME;
+        n += put_varint(rec + n, periods);
+    }
+    if (sample.current_temp != m_last.current_temp) {
+        ctrl |= REC_CURRENT;
+        n += put_varint(rec + n, zigzag(sample.current_temp - m_last.current_temp));
+    }
+    if (sample.target_temp != m_last.target_temp) {
+        ctrl |= REC_TARGET;
+        n += put_varint(rec + n, zigzag(sample.target_temp - m_last.target_temp));
+    }
+    if (pack_state(sample) != pack_state(m_last)) {
+        ctrl |= REC_STATE;
+        rec[n++] = pack_state(sample);
+    }
+    if (sample.duty != m_last.duty) {
+        ctrl |= REC_DUTY;
+        rec[n++] = sample.duty;
+    }
+    rec[0] = ctrl;
+    memcpy(b + used, rec, n);
+    put_u16(b + HDR_USED, used + n);
+
+    // Track the time the decoder will rebuild, so rounding can't drift
+    uint32_t decoded_time = m_last.time + periods * m_period_s;
+    m_last = sample;
+    m_last.time = decoded_time;
+}
+
+void TelemetryLog::CopyBlock(int index, uint8_t *out) const {
+    memcpy(out, Block(index), TELEMETRY_BLOCK_SIZE);
+}
+
+uint32_t TelemetryLog::OldestSeq() const {
+    return m_count ? get_u32(Block(0) + HDR_SEQ) : m_next_seq;
+}
+
+size_t TelemetryLog::BytesUsed() const {
+    size_t total = 0;
+    for (int i = 0; i < m_count; i++) total += get_u16(Block(i) + HDR_USED);
+    return total;
+}
+
+bool TelemetryLog::BlockSeq(const uint8_t *block, uint32_t *seq) {
+    uint16_t used = get_u16(block + HDR_USED);
+    if (block[0] != TELEMETRY_BLOCK_MAGIC || used < HDR_SIZE || used > TELEMETRY_BLOCK_SIZE) return false;
+    *seq = get_u32(block + HDR_SEQ);
+    return true;
+}
+
+int TelemetryLog::DecodeBlock(const uint8_t *block, telemetry_visit_cb_t visit, void *ctx) {
+    uint32_t seq;
+    if (!BlockSeq(block, &seq)) return -1;
+    const uint8_t *p = block + HDR_SIZE;
+    const uint8_t *end = block + get_u16(block + HDR_USED);
+    uint8_t period = block[HDR_PERIOD];
+
+    telemetry_sample_t s;
+    s.time = get_u32(block + HDR_TIME);
+    s.wall_clock = (block[HDR_FLAGS] & FLAG_WALL_CLOCK) != 0;
+    s.current_temp = (int8_t)block[HDR_KEY + 0];
+    s.target_temp = (int8_t)block[HDR_KEY + 1];
+    s.power = block[HDR_KEY + 2] & 1;
+    s.mode = block[HDR_KEY + 2] >> 1;
+    s.duty = block[HDR_KEY + 3];
+    visit(&s, ctx);
+    int count = 1;
+
+    while (p < end) {
+        uint8_t ctrl = *p++;
+        uint32_t v = 1;
+        int n;
+        if (ctrl & ~(REC_TIME | REC_CURRENT | REC_TARGET | REC_STATE | REC_DUTY)) return -1;
+        if (ctrl & REC_TIME) {
+            if (!(n = get_varint(p, end, &v))) return -1;
+            p += n;
+        }
+        s.time += v * period;
+        if (ctrl & REC_CURRENT) {
+            if (!(n = get_varint(p, end, &v))) return -1;
+            p += n;
+            s.current_temp = (int8_t)(s.current_temp + unzigzag(v));
+        }
+        if (ctrl & REC_TARGET) {
+            if (!(n = get_varint(p, end, &v))) return -1;
+            p += n;
+            s.target_temp = (int8_t)(s.target_temp + unzigzag(v));
+        }
+        if (ctrl & REC_STATE) {
+            if (p >= end) return -1;
+            s.power = *p & 1;
+            s.mode = *p++ >> 1;
+        }
+        if (ctrl & REC_DUTY) {
+            if (p >= end) return -1;
+            s.duty = *p++;
+        }
+        visit(&s, ctx);
+        count++;
+    }
+    return count;
+}
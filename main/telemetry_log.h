@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Fixed-size unit of the log: RAM ring slot and flash spill record alike
+#define TELEMETRY_BLOCK_SIZE    128
+#define TELEMETRY_BLOCK_MAGIC   0xB7
+
+typedef struct {
+    uint32_t time;          // Unix seconds, or seconds since boot if !wall_clock
+    bool wall_clock;
+    int8_t current_temp;    // °C, as reported by the MCU
+    int8_t target_temp;
+    bool power;
+    uint8_t mode;
+    uint8_t duty;           // % of the sample period spent heating
+} telemetry_sample_t;
+
+typedef void (*telemetry_visit_cb_t)(const telemetry_sample_t *sample, void *ctx);
+// Called once per sealed block, e.g. to copy it to flash
+typedef void (*telemetry_spill_cb_t)(const uint8_t *block, void *ctx);
+
+// Ring of delta-encoded telemetry blocks over caller-provided storage.
+//
+// Every block starts with an absolute keyframe (sequence number, time, first
+// sample); each further sample is a control byte saying which fields moved,
+// followed by zigzag varint deltas for those fields only. A steady minute
+// costs one byte, so days of 1-minute samples fit in a few KB. When the ring
+// is full the oldest block is dropped whole, so every block left decodes on
+// its own, in one pass, without any allocation. Not thread-safe; the owner
+// locks.
+class TelemetryLog {
+public:
+    TelemetryLog(uint8_t *storage, size_t size, uint8_t period_s);
+
+    void SetSpill(telemetry_spill_cb_t spill, void *ctx);
+    // Continue the sequence numbers of blocks already spilled before a reboot
+    void SetNextSeq(uint32_t seq) { m_next_seq = seq; }
+
+    void Append(const telemetry_sample_t &sample);
+
+    // Blocks in the ring, oldest first; the newest one may still be growing
+    int BlockCount() const { return m_count; }
+    void CopyBlock(int index, uint8_t *out) const;
+    uint32_t OldestSeq() const;
+
+    uint32_t Samples() const { return m_samples; }
+    size_t BytesUsed() const;
+    size_t Capacity() const { return (size_t)m_blocks * TELEMETRY_BLOCK_SIZE; }
+
+    // Sequence number of a block, or false if it is not a valid block.
+    // Only looks at the first 8 bytes.
+    static bool BlockSeq(const uint8_t *block, uint32_t *seq);
+    // Decodes every sample of a block in order. Returns the count, -1 if corrupt.
+    static int DecodeBlock(const uint8_t *block, telemetry_visit_cb_t visit, void *ctx);
+
+private:
+    uint8_t *m_storage;
+    int m_blocks;
+    uint8_t m_period_s;
+
+    int m_first;                // Ring index of the oldest block
+    int m_count;
+    bool m_open;                // Newest block still takes samples
+    uint32_t m_next_seq;
+    uint32_t m_samples;
+    telemetry_sample_t m_last;  // Last sample of the open block
+
+    telemetry_spill_cb_t m_spill;
+    void *m_spill_ctx;
+
+    uint8_t *Block(int index) const { return m_storage + (size_t)((m_first + index) % m_blocks) * TELEMETRY_BLOCK_SIZE; }
+    void Seal();
+    void StartBlock(const telemetry_sample_t &sample);
+};
@@ -0,0 +1,60 @@
+#include "temp_filter.h"
+#include <stdlib.h>
+
+TempFilter::TempFilter(uint8_t shift, int16_t hysteresis, uint32_t min_report_ms) {
+    m_shift = shift;
+    m_hysteresis = hysteresis > 0 ? hysteresis : 1;
+    m_min_report_ms = min_report_ms;
+
+    m_primed = false;
+    m_has_reported = false;
+    m_raw = 0;
+    m_acc = 0;
+    m_reported = 0;
+    m_reported_at_ms = 0;
+}
+
+void TempFilter::Sample(int16_t raw) {
+    m_raw = raw;
+    if (!m_primed) {
+        m_acc = ToFixed(raw);
+        m_primed = true;
+    }
+}
+
+int16_t TempFilter::Value() const {
+    // Round to nearest 0.01 °C (arithmetic shift floors negative values too)
+    return (int16_t)((m_acc + (1 << (kFracBits - 1))) >> kFracBits);
+}
+
+bool TempFilter::Step(uint32_t now_ms, int16_t *value) {
+    if (!m_primed) return false;
+
+    int32_t target = ToFixed(m_raw);
+    int32_t diff = target - m_acc;
+    // Snap the last fraction instead of creeping towards it forever
+    if (abs(diff) < (1 << m_shift)) {
+        m_acc = target;
+    } else {
+        m_acc += diff / (1 << m_shift);
+    }
+
+    int16_t filtered = Value();
+    if (m_has_reported) {
+        if (abs(filtered - m_reported) < m_hysteresis) return false;
+        if (now_ms - m_reported_at_ms < m_min_report_ms) return false;
+    }
+
+    m_has_reported = true;
+    m_reported = filtered;
+    m_reported_at_ms = now_ms;
+    *value = filtered;
+    return true;
+}
+
+bool TempFilter::Idle() const {
+    if (!m_primed) return true;
+    if (m_acc != ToFixed(m_raw)) return false;
+    // Settled, but a report may still be waiting for the minimum interval
+    return !m_has_reported || abs(Value() - m_reported) < m_hysteresis;
+}
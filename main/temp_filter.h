@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+// Exponential moving average for the room temperature, in fixed point.
+//
+// The MCU only reports whole degrees, and only when the reading changes, so a
+// room sitting between two degrees dithers back and forth. The filter is
+// stepped on a fixed tick towards the latest raw reading, which turns that
+// dither into a fractional value and lets a single step settle smoothly. A
+// new value is only worth reporting once it has moved by the hysteresis and
+// the minimum report interval has passed.
+class TempFilter {
+public:
+    // alpha = 1 / 2^shift per tick; hysteresis in 0.01 °C
+    TempFilter(uint8_t shift, int16_t hysteresis, uint32_t min_report_ms);
+
+    // New raw reading (0.01 °C). The very first one is taken as-is.
+    void Sample(int16_t raw);
+
+    // Advance one tick. Returns true if *value (0.01 °C) should be reported.
+    bool Step(uint32_t now_ms, int16_t *value);
+
+    // Nothing left to do until the next Sample(): the filter reached the raw
+    // reading and no report is being held back by the minimum interval
+    bool Idle() const;
+
+    bool HasValue() const { return m_primed; }
+    int16_t Value() const;
+
+private:
+    static constexpr int kFracBits = 8;
+    static int32_t ToFixed(int16_t v) { return (int32_t)v * (1 << kFracBits); }
+
+    uint8_t m_shift;
+    int16_t m_hysteresis;
+    uint32_t m_min_report_ms;
+
+    bool m_primed;
+    bool m_has_reported;
+    int16_t m_raw;
+    int32_t m_acc;              // Filtered value, 0.01 °C << kFracBits
+    int16_t m_reported;
+    uint32_t m_reported_at_ms;
+};
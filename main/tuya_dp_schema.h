@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <type_traits>
+
+// Tuya DP data types (second byte of every DP record)
+#define TUYA_TYPE_RAW    0x00
+#define TUYA_TYPE_BOOL   0x01
+#define TUYA_TYPE_VALUE  0x02
+#define TUYA_TYPE_STRING 0x03
+#define TUYA_TYPE_ENUM   0x04
+#define TUYA_TYPE_BITMAP 0x05
+
+// Wire width implied by the DP type
+constexpr uint8_t tuya_type_width(uint8_t type) {
+    return (type == TUYA_TYPE_VALUE || type == TUYA_TYPE_BITMAP) ? 4 : 1;
+}
+
+// Deliberately not constexpr: reaching it while building a schema at
+// compile time turns a duplicate DP id into a build error
+void tuya_dp_schema_duplicate_id();
+
+// Type-erased view of one DP, used for decode dispatch
+template <typename State>
+struct TuyaDpDesc {
+    uint8_t id;
+    uint8_t type;
+    uint8_t width;
+    bool inverted;
+    bool (*store)(State *state, int32_t raw);       // Returns true if the field changed
+    int32_t (*load)(const State *state);
+};
+
+template <typename M> struct tuya_member_traits;
+template <typename S, typename T> struct tuya_member_traits<T S::*> {
+    using state_type = S;
+    using value_type = T;
+};
+
+// One datapoint: id, Tuya type, optional inverted boolean logic, and the
+// state field it maps to. Encode/decode are generated from this definition.
+template <uint8_t Id, uint8_t Type, auto Member, bool Inverted = false>
+struct TuyaDp {
+    using state_type = typename tuya_member_traits<decltype(Member)>::state_type;
+    using value_type = typename tuya_member_traits<decltype(Member)>::value_type;
+
+    static constexpr uint8_t id = Id;
+    static constexpr uint8_t type = Type;
+    static constexpr uint8_t width = tuya_type_width(Type);
+
+    static_assert(Type == TUYA_TYPE_BOOL || Type == TUYA_TYPE_VALUE || Type == TUYA_TYPE_ENUM ||
+                  Type == TUYA_TYPE_BITMAP, "Only fixed-width DP types are supported");
+    static_assert(Type != TUYA_TYPE_BOOL || std::is_same<value_type, bool>::value, "BOOL DPs map to bool fields");
+    static_assert(Type == TUYA_TYPE_BOOL || std::is_integral<value_type>::value, "DP fields must be integral");
+    static_assert(sizeof(value_type) <= 4, "DP fields are at most 32 bits on the wire");
+    static_assert(!Inverted || Type == TUYA_TYPE_BOOL, "Only BOOL DPs can be inverted");
+
+    static constexpr int32_t ToWire(value_type v) {
+        if constexpr (Type == TUYA_TYPE_BOOL) return (v != Inverted) ? 1 : 0;
+        else return (int32_t)v;
+    }
+
+    static constexpr value_type FromWire(int32_t raw) {
+        if constexpr (Type == TUYA_TYPE_BOOL) return (raw != 0) != Inverted;
+        else return (value_type)raw;
+    }
+
+    // Big-endian value bytes for a 0x06 record. Returns the width.
+    static int Encode(value_type v, uint8_t *out) {
+        uint32_t raw = (uint32_t)ToWire(v);
+        for (int i = width - 1; i >= 0; i--) {
+            out[i] = raw & 0xFF;
+            raw >>= 8;
+        }
+        return width;
+    }
+
+    static bool Store(state_type *state, int32_t raw) {
+        value_type v = FromWire(raw);
+        if (state->*Member == v) return false;
+        state->*Member = v;
+        return true;
+    }
+
+    static int32_t Load(const state_type *state) { return ToWire(state->*Member); }
+
+    static constexpr TuyaDpDesc<state_type> Desc() {
+        return { Id, Type, width, Inverted, &Store, &Load };
+    }
+};
+
+// The full DP table of a device. Lookup by DP id is a single array index.
+template <typename State, typename... Dps>
+struct TuyaDpSchema {
+    static constexpr size_t kCount = sizeof...(Dps);
+    static_assert(kCount < 255, "Too many DPs");
+
+    static constexpr TuyaDpDesc<State> kTable[] = { Dps::Desc()... };
+
+    static constexpr const TuyaDpDesc<State> *Find(uint8_t id) {
+        return kIndex[id] ? &kTable[kIndex[id] - 1] : nullptr;
+    }
+
+    // Dense position of a DP in the table, or -1
+    static constexpr int IndexOf(uint8_t id) { return (int)kIndex[id] - 1; }
+
+    template <typename Dp>
+    static constexpr bool Contains() {
+        return (std::is_same<Dp, Dps>::value || ...);
+    }
+
+private:
+    static constexpr std::array<uint8_t, 256> BuildIndex() {
+        std::array<uint8_t, 256> index = {};
+        for (size_t i = 0; i < kCount; i++) {
+            if (index[kTable[i].id] != 0) tuya_dp_schema_duplicate_id();
+            index[kTable[i].id] = (uint8_t)(i + 1);
+        }
+        return index;
+    }
+
+    // id -> position + 1 (0 = unknown DP), built at compile time
+    static constexpr std::array<uint8_t, 256> kIndex = BuildIndex();
+};
@@ -1,268 +1,726 @@
 #include "tuya_driver.h"
-#include <driver/uart.h>
-#include <driver/gpio.h>
+#include "latency_trace.h"
 #include <esp_log.h>
-#include <esp_timer.h>
 #include <string.h>
 
-// --- NEW: Required for vTaskDelay ---
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
-
 static const char *TAG = "TUYA_DRIVER";
 
-#define BAUD_RATE 9600
-
 TuyaHeaterDriver::TuyaHeaterDriver() {
     m_callback = nullptr;
     m_reset_callback = nullptr;
-    m_uart_num = UART_NUM_1;
+    m_link_callback = nullptr;
+    m_callback_ctx = nullptr;
+    m_reset_ctx = nullptr;
+    m_link_ctx = nullptr;
+    m_hal = nullptr;
     
     m_state.power = false;
     m_state.target_temp = 22;
     m_state.current_temp = 20;
     m_state.mode = MODE_HIGH;
     m_state.screen_on = true;
+    m_snapshot.Store(m_state);
+
+    m_cmd_head = 0;
+    m_cmd_count = 0;
+    memset(m_cmd_queue, 0, sizeof(m_cmd_queue));
+    memset(&m_cmd_stats, 0, sizeof(m_cmd_stats));
+    memset(&m_io_stats, 0, sizeof(m_io_stats));
+    memset(m_quiet_windows, 0, sizeof(m_quiet_windows));
+    memset(&m_batch, 0, sizeof(m_batch));
+    m_batch_open = false;
+    m_batch_ordered = false;
 
-    // Init Buffer Counter
-    rx_count = 0;
-    memset(rx_buffer, 0, RX_BUF_SIZE);
+    m_synced = false;
+    m_seen_dps = 0;
+    m_sync_attempts = 0;
+    m_sync_started_us = 0;
+    m_next_sync_us = 0;
+
+    m_link_state = TUYA_LINK_UNKNOWN;
+    m_hb_outstanding = false;
+    m_hb_answered = false;
+    m_mcu_boot = TUYA_MCU_BOOT_UNKNOWN;
+    m_hb_missed = 0;
+    m_hb_deadline_us = 0;
+
+    m_rx_damage_seen = 0;
+    m_recover_query_us = 0;
 
     // Reset detection init
     last_toggle_time = 0;
     toggle_count = 0;
+    m_power_acked_us = 0;
 }
 
-esp_err_t TuyaHeaterDriver::Init(int tx_pin, int rx_pin) {
-    uart_config_t uart_config = {
-        .baud_rate = BAUD_RATE,
-        .data_bits = UART_DATA_8_BITS,
-        .parity    = UART_PARITY_DISABLE,
-        .stop_bits = UART_STOP_BITS_1,
-        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
-        .source_clk = UART_SCLK_DEFAULT,
-    };
-    
-    // Install UART driver with internal buffer (buffer size x2)
-    esp_err_t err = uart_driver_install((uart_port_t)m_uart_num, 1024, 0, 0, NULL, 0);
-    if (err != ESP_OK) return err;
-    
-    err = uart_param_config((uart_port_t)m_uart_num, &uart_config);
-    if (err != ESP_OK) return err;
-    
-    err = uart_set_pin((uart_port_t)m_uart_num, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
-    return err;
+esp_err_t TuyaHeaterDriver::Init(TuyaHal *hal) {
+    if (!hal) return ESP_ERR_INVALID_ARG;
+    m_hal = hal;
+    // Tuya protocol: heartbeat first, then product info and status
+    m_hb_deadline_us = m_hal->NowUs();
+    ServiceLink();
+    StartSync();
+    return ESP_OK;
+}
+
+// --- BOOT HANDSHAKE ---
+void TuyaHeaterDriver::StartSync() {
+    m_synced = false;
+    m_seen_dps = 0;
+    m_sync_attempts = 0;
+    m_sync_started_us = m_hal->NowUs();
+    m_next_sync_us = m_sync_started_us; // First query goes out immediately
+    ServiceSync();
+}
+
+void TuyaHeaterDriver::ServiceSync() {
+    if (m_synced) return;
+    int64_t now = m_hal->NowUs();
+    if (now < m_next_sync_us) return;
+
+    // Product info mostly for the log; the status query is what fills m_state
+    if (m_sync_attempts == 0) SendFrame(TUYA_CMD_PRODUCT_INFO, nullptr, 0);
+    SendFrame(TUYA_CMD_QUERY_STATUS, nullptr, 0);
+    m_sync_attempts++;
+
+    if (m_sync_attempts < TUYA_SYNC_FAST_ATTEMPTS) {
+        m_next_sync_us = now + TUYA_SYNC_RETRY_MS * 1000LL;
+        return;
+    }
+    if (m_seen_dps != 0) {
+        // The MCU answers but never reports some DPs; go with what we have
+        ESP_LOGW(TAG, "MCU did not report all DPs (seen mask 0x%lx), using partial state", (unsigned long)m_seen_dps);
+        CompleteSync();
+        return;
+    }
+    if (m_sync_attempts == TUYA_SYNC_FAST_ATTEMPTS) {
+        ESP_LOGW(TAG, "No answer from heater MCU, slowing down status queries");
+    }
+    m_next_sync_us = now + TUYA_SYNC_SLOW_RETRY_MS * 1000LL;
+}
+
+void TuyaHeaterDriver::CompleteSync() {
+    m_synced = true;
+    int64_t now = m_hal->NowUs();
+    ESP_LOGI(TAG, "Heater state synced in %lld ms (%d queries), boot +%lld ms",
+             (long long)((now - m_sync_started_us) / 1000), m_sync_attempts, (long long)(now / 1000));
+    if (m_link_state == TUYA_LINK_RESYNC) SetLinkState(TUYA_LINK_UP);
+    // Everything held back so far goes out in one go
+    NotifyStateChange();
+}
+
+// --- LINK MONITOR ---
+void TuyaHeaterDriver::ServiceLink() {
+    int64_t now = m_hal->NowUs();
+    if (now < m_hb_deadline_us) return;
+
+    if (m_hb_outstanding) {
+        // Reply overdue
+        m_hb_outstanding = false;
+        m_hb_missed++;
+        ESP_LOGW(TAG, "Heartbeat reply missed (%d in a row)", m_hb_missed);
+        SetLinkState(m_hb_missed >= TUYA_HB_MISSES_DOWN ? TUYA_LINK_DOWN : TUYA_LINK_DEGRADED);
+        m_hb_deadline_us = now + TUYA_HB_FAST_MS * 1000LL;
+        return;
+    }
+
+    SendFrame(TUYA_CMD_HEARTBEAT, nullptr, 0);
+    m_hb_outstanding = true;
+    m_hb_deadline_us = now + TUYA_HB_REPLY_TIMEOUT_MS * 1000LL;
+}
+
+void TuyaHeaterDriver::HandleHeartbeatReply(const TuyaFrame &packet) {
+    // Payload 0x00: first heartbeat the MCU answered since it booted
+    bool mcu_restarted = packet.PayloadLength() >= 1 && packet[6] == 0x00;
+
+    m_hb_outstanding = false;
+    m_hb_missed = 0;
+    m_hb_deadline_us = m_hal->NowUs() + TUYA_HB_HEALTHY_MS * 1000LL;
+    if (!m_hb_answered || mcu_restarted) m_mcu_boot = mcu_restarted ? TUYA_MCU_BOOT_FRESH : TUYA_MCU_BOOT_RUNNING;
+
+    if (mcu_restarted && m_hb_answered) {
+        // Brown-out or watchdog on the heater side: its state may have reset
+        ESP_LOGW(TAG, "Heater MCU restarted, re-syncing state");
+        SetLinkState(TUYA_LINK_RESYNC);
+        StartSync();
+    } else if (m_link_state != TUYA_LINK_RESYNC || m_synced) {
+        // Reports may have been lost while the line was dead
+        if (m_link_state == TUYA_LINK_DOWN) RequestStatus();
+        SetLinkState(TUYA_LINK_UP);
+    }
+    m_hb_answered = true;
+}
+
+void TuyaHeaterDriver::SetLinkState(tuya_link_state_t state) {
+    if (m_link_state == state) return;
+    static const char *names[] = { "UNKNOWN", "UP", "DEGRADED", "DOWN", "RESYNC" };
+    ESP_LOGI(TAG, "MCU link %s -> %s", names[m_link_state], names[state]);
+    m_link_state = state;
+    if (m_link_callback) m_link_callback(state, m_link_ctx);
 }
 
-void TuyaHeaterDriver::SendCommand(uint8_t dp_id, uint8_t type, const uint8_t *value, int len) {
+uint32_t TuyaHeaterDriver::LinkWaitMs(uint32_t timeout_ms) {
+    int64_t remaining_us = m_hb_deadline_us - m_hal->NowUs();
+    if (remaining_us <= 0) return 0;
+    uint32_t remaining_ms = (uint32_t)((remaining_us + 999) / 1000);
+    return (remaining_ms < timeout_ms) ? remaining_ms : timeout_ms;
+}
+
+uint32_t TuyaHeaterDriver::SyncWaitMs(uint32_t timeout_ms) {
+    if (m_synced) return timeout_ms;
+    int64_t remaining_us = m_next_sync_us - m_hal->NowUs();
+    if (remaining_us <= 0) return 0;
+    uint32_t remaining_ms = (uint32_t)((remaining_us + 999) / 1000);
+    return (remaining_ms < timeout_ms) ? remaining_ms : timeout_ms;
+}
+
+void TuyaHeaterDriver::SendFrame(uint8_t command, const uint8_t *payload, int len) {
     // Fixed stack buffer for constructing commands (Max 64 bytes is plenty for Tuya)
     uint8_t frame[64];
+    if (len > (int)sizeof(frame) - TUYA_FRAME_OVERHEAD) return;
     int idx = 0;
 
     frame[idx++] = TUYA_HEADER_0;
     frame[idx++] = TUYA_HEADER_1;
     frame[idx++] = 0x00; // Ver
-    frame[idx++] = 0x06; // Command
-
-    // Data Len = DP_ID(1) + Type(1) + Len(2) + Value(len)
-    uint16_t data_len = 1 + 1 + 2 + len;
-    frame[idx++] = (data_len >> 8) & 0xFF;
-    frame[idx++] = data_len & 0xFF;
-
-    frame[idx++] = dp_id;
-    frame[idx++] = type;
+    frame[idx++] = command;
     frame[idx++] = (len >> 8) & 0xFF;
     frame[idx++] = len & 0xFF;
 
-    memcpy(&frame[idx], value, len);
+    if (len > 0) memcpy(&frame[idx], payload, len);
     idx += len;
     
     uint8_t cs = 0;
     for (int i = 0; i < idx; i++) cs += frame[i];
     frame[idx++] = cs;
     
-    uart_write_bytes((uart_port_t)m_uart_num, (const char*)frame, idx);
+    tuya_tx_prio_t prio = TUYA_TX_PRIO_QUERY;
+    if (command == TUYA_CMD_SET_DP) prio = TUYA_TX_PRIO_COMMAND;
+    else if (command == TUYA_CMD_HEARTBEAT) prio = TUYA_TX_PRIO_HEARTBEAT;
+
+    // Returns at once; a dropped frame is recovered by the ack/heartbeat timers
+    int written = m_hal->WriteFrame(frame, idx, prio);
+    if (written > 0) {
+        m_io_stats.bytes_out += written;
+        m_io_stats.frames_out++;
+    }
+}
+
+void TuyaHeaterDriver::SendCommand(const tuya_pending_cmd_t &cmd) {
+    uint8_t payload[TUYA_MAX_BATCH_DPS * 8];
+    int idx = 0;
+    int64_t now = m_hal->NowUs();
+
+    // One record per DP still awaiting its echo:
+    // DP_ID(1) + Type(1) + Len(2) + Value(len)
+    for (int i = 0; i < cmd.count; i++) {
+        if (cmd.acked_mask & (1 << i)) continue;
+        const tuya_dp_write_t &dp = cmd.dps[i];
+        payload[idx++] = dp.dp_id;
+        payload[idx++] = dp.type;
+        payload[idx++] = (dp.len >> 8) & 0xFF;
+        payload[idx++] = dp.len & 0xFF;
+        memcpy(&payload[idx], dp.value, dp.len);
+        idx += dp.len;
+        latency_trace_mark(dp.dp_id, LATENCY_STAGE_UART_TX, now);
+    }
+
+    SendFrame(TUYA_CMD_SET_DP, payload, idx);
+}
+
+// --- COMMAND PIPELINE ---
+void TuyaHeaterDriver::QueueWrite(uint8_t dp_id, uint8_t type, const uint8_t *value, int len, bool ordered) {
+    tuya_dp_write_t rec;
+    rec.dp_id = dp_id;
+    rec.type = type;
+    rec.len = len;
+    memcpy(rec.value, value, len);
+
+    {
+        std::lock_guard<std::mutex> lock(m_cmd_lock);
+        tuya_quiet_window_t *window = FindQuietWindowLocked(dp_id);
+        if (window && m_hal) {
+            // Latest wins; the poll task queues it once the DP has gone quiet
+            if (window->held) m_cmd_stats.writes_coalesced++;
+            window->pending = rec;
+            window->held = true;
+            window->release_us = m_hal->NowUs() + window->quiet_ms * 1000LL;
+        } else if (m_batch_open) {
+            // An ordered write must reach the MCU after everything before it,
+            // so the batch so far becomes its own frame
+            if (ordered && m_batch.count > 0) {
+                EnqueueLocked(m_batch, m_batch_ordered);
+                m_batch.count = 0;
+            }
+            for (int i = 0; i < m_batch.count; i++) {
+                if (m_batch.dps[i].dp_id == dp_id) {
+                    m_batch.dps[i] = rec;
+                    m_cmd_stats.writes_coalesced++;
+                    return;
+                }
+            }
+            if (m_batch.count == TUYA_MAX_BATCH_DPS) {
+                EnqueueLocked(m_batch, m_batch_ordered);
+                m_batch.count = 0;
+            }
+            if (m_batch.count == 0) m_batch_ordered = ordered;
+            m_batch.dps[m_batch.count++] = rec;
+            return; // CommitBatch() wakes the poll task
+        } else {
+            tuya_pending_cmd_t cmd;
+            cmd.dps[0] = rec;
+            cmd.count = 1;
+            EnqueueLocked(cmd, ordered);
+        }
+    }
+    // The poll task owns the UART (and the release of held writes)
+    if (m_hal) m_hal->Wake();
+}
+
+bool TuyaHeaterDriver::CoalesceLocked(const tuya_dp_write_t &dp, bool ordered) {
+    // Latest wins: overwrite a write to the same DP that is still queued.
+    // The frame already on the wire (if any) has to run its course.
+    for (int i = m_cmd_count - 1; i >= 0; i--) {
+        tuya_pending_cmd_t &cmd = m_cmd_queue[(m_cmd_head + i) % TUYA_CMD_QUEUE_LEN];
+        if (cmd.sent) break;
+
+        for (int j = 0; j < cmd.count; j++) {
+            if (cmd.dps[j].dp_id != dp.dp_id) continue;
+            cmd.dps[j] = dp;
+            m_cmd_stats.writes_coalesced++;
+            return true;
+        }
+
+        // Ordered writes may not jump ahead of frames queued before them
+        if (ordered) break;
+    }
+    return false;
+}
+
+void TuyaHeaterDriver::EnqueueLocked(tuya_pending_cmd_t &cmd, bool ordered) {
+    int kept = 0;
+    for (int i = 0; i < cmd.count; i++) {
+        if (!CoalesceLocked(cmd.dps[i], ordered)) {
+            cmd.dps[kept++] = cmd.dps[i];
+        }
+    }
+    cmd.count = kept;
+    if (kept == 0) return;
+
+    if (m_cmd_count == TUYA_CMD_QUEUE_LEN) {
+        ESP_LOGW(TAG, "Command queue full, dropping write to %d DP(s)", kept);
+        return;
+    }
+    cmd.acked_mask = 0;
+    cmd.retries = 0;
+    cmd.sent = false;
+    cmd.sent_at_us = 0;
+    m_cmd_queue[(m_cmd_head + m_cmd_count) % TUYA_CMD_QUEUE_LEN] = cmd;
+    m_cmd_count++;
+    m_cmd_stats.writes_queued += kept;
+}
+
+void TuyaHeaterDriver::BeginBatch() {
+    std::lock_guard<std::mutex> lock(m_cmd_lock);
+    if (m_batch_open) return;
+    m_batch_open = true;
+    m_batch.count = 0;
+}
+
+void TuyaHeaterDriver::CommitBatch() {
+    {
+        std::lock_guard<std::mutex> lock(m_cmd_lock);
+        if (!m_batch_open) return;
+        m_batch_open = false;
+        if (m_batch.count == 0) return;
+        EnqueueLocked(m_batch, m_batch_ordered);
+    }
+    if (m_hal) m_hal->Wake();
+}
+
+bool TuyaHeaterDriver::ConfirmWrite(uint8_t dp_id, uint32_t value) {
+    std::lock_guard<std::mutex> lock(m_cmd_lock);
+    if (m_cmd_count == 0) return false;
+
+    tuya_pending_cmd_t &cmd = m_cmd_queue[m_cmd_head];
+    if (!cmd.sent) return false;
+
+    // Only a report carrying the written value is an echo. A status report
+    // or a spontaneous one may still show the old value (e.g. a mode write
+    // the heater dropped while waking up); that write has to be retried.
+    bool confirmed = false;
+    for (int i = 0; i < cmd.count; i++) {
+        const tuya_dp_write_t &dp = cmd.dps[i];
+        if (dp.dp_id != dp_id || (cmd.acked_mask & (1 << i))) continue;
+        uint32_t written = 0;
+        for (int j = 0; j < dp.len; j++) written = (written << 8) | dp.value[j];
+        if (written != value) continue;
+        cmd.acked_mask |= (1 << i);
+        confirmed = true;
+        if (dp_id == DP_POWER) m_power_acked_us = m_hal->NowUs();
+    }
+    if (cmd.acked_mask != (1 << cmd.count) - 1) return confirmed;
+
+    ESP_LOGD(TAG, "%d DP(s) acknowledged after %lld us", cmd.count, (long long)(m_hal->NowUs() - cmd.sent_at_us));
+    m_cmd_head = (m_cmd_head + 1) % TUYA_CMD_QUEUE_LEN;
+    m_cmd_count--;
+    return confirmed;
+}
+
+void TuyaHeaterDriver::ServiceCommands() {
+    tuya_pending_cmd_t to_send;
+    {
+        std::lock_guard<std::mutex> lock(m_cmd_lock);
+        int64_t now = m_hal->NowUs();
+        ReleaseQuietWindowsLocked(now);
+        for (;;) {
+            if (m_cmd_count == 0) return;
+
+            tuya_pending_cmd_t &cmd = m_cmd_queue[m_cmd_head];
+            if (!cmd.sent) break;
+            if (now - cmd.sent_at_us < TUYA_CMD_ACK_TIMEOUT_MS * 1000LL) return;
+
+            if (cmd.retries < TUYA_CMD_MAX_RETRIES) {
+                cmd.retries++;
+                m_cmd_stats.retries++;
+                ESP_LOGW(TAG, "No echo for DP %d, retry %d/%d", cmd.dps[0].dp_id, cmd.retries, TUYA_CMD_MAX_RETRIES);
+                break;
+            }
+
+            // Give up on this step so the ones behind it are not stuck forever
+            ESP_LOGE(TAG, "DP %d never acknowledged, dropping", cmd.dps[0].dp_id);
+            m_cmd_stats.timeouts++;
+            m_cmd_head = (m_cmd_head + 1) % TUYA_CMD_QUEUE_LEN;
+            m_cmd_count--;
+        }
+
+        tuya_pending_cmd_t &cmd = m_cmd_queue[m_cmd_head];
+        cmd.sent = true;
+        cmd.sent_at_us = now;
+        m_cmd_stats.frames_sent++;
+        to_send = cmd;
+    }
+    // Write outside the lock so setters never wait on the UART
+    SendCommand(to_send);
+}
+
+uint32_t TuyaHeaterDriver::CommandWaitMs(uint32_t timeout_ms) {
+    std::lock_guard<std::mutex> lock(m_cmd_lock);
+    int64_t now = m_hal->NowUs();
+    int64_t deadline = now + timeout_ms * 1000LL;
+
+    if (m_cmd_count > 0) {
+        const tuya_pending_cmd_t &cmd = m_cmd_queue[m_cmd_head];
+        if (!cmd.sent) return 0;
+        int64_t ack_deadline = cmd.sent_at_us + TUYA_CMD_ACK_TIMEOUT_MS * 1000LL;
+        if (ack_deadline < deadline) deadline = ack_deadline;
+    }
+    for (int i = 0; i < TUYA_MAX_QUIET_WINDOWS; i++) {
+        const tuya_quiet_window_t &window = m_quiet_windows[i];
+        if (window.held && window.release_us < deadline) deadline = window.release_us;
+    }
+
+    int64_t remaining_us = deadline - now;
+    if (remaining_us <= 0) return 0;
+    uint32_t remaining_ms = (uint32_t)((remaining_us + 999) / 1000);
+    return (remaining_ms < timeout_ms) ? remaining_ms : timeout_ms;
+}
+
+tuya_quiet_window_t *TuyaHeaterDriver::FindQuietWindowLocked(uint8_t dp_id) {
+    for (int i = 0; i < TUYA_MAX_QUIET_WINDOWS; i++) {
+        if (m_quiet_windows[i].dp_id == dp_id) return &m_quiet_windows[i];
+    }
+    return nullptr;
+}
+
+// Held writes whose DP has gone quiet join the pipeline (merged into a
+// queued write to the same DP if there is one)
+void TuyaHeaterDriver::ReleaseQuietWindowsLocked(int64_t now) {
+    for (int i = 0; i < TUYA_MAX_QUIET_WINDOWS; i++) {
+        tuya_quiet_window_t &window = m_quiet_windows[i];
+        if (!window.held || now < window.release_us) continue;
+        window.held = false;
+
+        tuya_pending_cmd_t cmd;
+        cmd.dps[0] = window.pending;
+        cmd.count = 1;
+        EnqueueLocked(cmd, false);
+    }
+}
+
+void TuyaHeaterDriver::SetCoalesceWindow(uint8_t dp_id, uint32_t quiet_ms) {
+    std::lock_guard<std::mutex> lock(m_cmd_lock);
+    tuya_quiet_window_t *slot = nullptr;
+    for (int i = 0; i < TUYA_MAX_QUIET_WINDOWS; i++) {
+        if (m_quiet_windows[i].dp_id == dp_id) { slot = &m_quiet_windows[i]; break; }
+        if (!slot && m_quiet_windows[i].dp_id == 0) slot = &m_quiet_windows[i];
+    }
+    if (!slot) {
+        ESP_LOGW(TAG, "No free quiet window slot for DP %d", dp_id);
+        return;
+    }
+    slot->dp_id = quiet_ms ? dp_id : 0;
+    slot->quiet_ms = quiet_ms;
 }
 
-// --- UPDATED FUNCTION: Split Command with Delay ---
 void TuyaHeaterDriver::SetPowerAndMode(bool on, uint8_t mode) {
-    // 1. Send Power Command
+    // The pipeline only sends the mode once the MCU has echoed the power DP,
+    // i.e. as soon as the heater is awake instead of after a fixed delay.
     SetPower(on);
-    
-    // 2. Wait 300ms for the MCU to wake up and verify the checksum
-    // The ESP32 task will pause here, allowing the heater to beep/turn on.
-    vTaskDelay(pdMS_TO_TICKS(300)); 
-    
-    // 3. Send Mode Command
+
     // Only send if we are turning ON. If turning OFF, mode setting is usually ignored anyway.
+    // Ordered: never folded into a frame ahead of the power write (or batched with it).
     if (on) {
-        SetMode(mode);
+        Write<DpMode>(mode, true);
     }
 }
 
-void TuyaHeaterDriver::SendHeartbeat() {
-    uint8_t query[] = {0x55, 0xAA, 0x00, 0x08, 0x00, 0x00, 0x07};
-    uart_write_bytes((uart_port_t)m_uart_num, (const char*)query, 7);
+void TuyaHeaterDriver::RequestStatus() {
+    SendFrame(TUYA_CMD_QUERY_STATUS, nullptr, 0);
 }
 
-void TuyaHeaterDriver::Poll() {
-    // Read directly into the buffer at the current offset
-    int remaining_space = RX_BUF_SIZE - rx_count;
-    if (remaining_space <= 0) {
-        // Safety: Buffer full, reset
-        rx_count = 0;
-        remaining_space = RX_BUF_SIZE;
+int TuyaHeaterDriver::ReadAndParse(uint32_t timeout_ms) {
+    // Read directly into the free region of the ring
+    size_t space;
+    uint8_t *dst = m_parser.WritePtr(&space);
+    if (space == 0) {
+        // Unreachable: every pass below drains the parser, which then holds
+        // at most one incomplete frame, and TUYA_MAX_PAYLOAD makes any frame
+        // fit the ring. Should it happen anyway, the bytes show up as dropped.
+        ESP_LOGE(TAG, "RX ring full with %u bytes pending, discarding", (unsigned)m_parser.Pending());
+        m_parser.Discard();
+        dst = m_parser.WritePtr(&space);
     }
 
-    // Read directly to static memory
-    int len = uart_read_bytes((uart_port_t)m_uart_num, &rx_buffer[rx_count], remaining_space, pdMS_TO_TICKS(50));
-    
-    if (len > 0) {
-        rx_count += len;
-        
-        // Loop to process all available packets
-        while (rx_count >= 7) { 
-            
-            // 1. Check Header
-            if (rx_buffer[0] != TUYA_HEADER_0 || rx_buffer[1] != TUYA_HEADER_1) {
-                memmove(rx_buffer, &rx_buffer[1], rx_count - 1);
-                rx_count--;
-                continue;
-            }
-            
-            // 2. Check Payload Length
-            uint16_t payload_len = (rx_buffer[4] << 8) | rx_buffer[5];
-            int total_len = 6 + payload_len + 1; 
-            
-            // Wait for full packet
-            if (rx_count < total_len) {
-                break; 
-            }
-            
-            // 3. Verify Checksum
-            uint8_t calc_cs = 0;
-            for(int i=0; i < total_len - 1; i++) calc_cs += rx_buffer[i];
-            
-            if (calc_cs == rx_buffer[total_len - 1]) {
-                ProcessPacket(rx_buffer, total_len);
-            }
-            
-            // 4. Remove processed packet
-            int remaining = rx_count - total_len;
-            if (remaining > 0) {
-                memmove(rx_buffer, &rx_buffer[total_len], remaining);
-            }
-            rx_count = remaining;
+    int len = m_hal->Read(dst, space, timeout_ms);
+    if (len < 0) {
+        // Receiver dropped bytes; the partial frame can't be trusted
+        m_parser.Reset();
+        m_io_stats.rx_overruns++;
+        RecoverLostReport();
+        return 0;
+    }
+    if (len == 0) return 0;
+
+    m_parser.Commit(len);
+    m_io_stats.bytes_in += len;
+
+    // Hand every complete frame to ProcessPacket without copying it out
+    TuyaFrame frame;
+    while (m_parser.Next(&frame)) {
+        ProcessPacket(frame);
+    }
+
+    const tuya_parser_stats_t &stats = m_parser.GetStats();
+    uint32_t damage = stats.frames_bad_checksum + stats.bytes_dropped;
+    if (damage != m_rx_damage_seen) {
+        m_rx_damage_seen = damage;
+        RecoverLostReport();
+    }
+    return len;
+}
+
+// Bytes went missing (noise, RX overflow, or the edges that woke the chip
+// from light sleep). Whatever the MCU was reporting is gone, so ask again.
+void TuyaHeaterDriver::RecoverLostReport() {
+    if (!m_synced) return; // The handshake keeps querying on its own
+
+    int64_t now = m_hal->NowUs();
+    if (m_recover_query_us != 0 && now - m_recover_query_us < (int64_t)TUYA_RECOVER_QUERY_MS * 1000) return;
+    m_recover_query_us = now;
+
+    ESP_LOGD(TAG, "Damaged RX data, re-querying status");
+    RequestStatus();
+}
+
+uint32_t TuyaHeaterDriver::NextWaitMs(uint32_t timeout_ms) {
+    if (!m_hal) return timeout_ms;
+    return CommandWaitMs(SyncWaitMs(LinkWaitMs(timeout_ms)));
+}
+
+void TuyaHeaterDriver::Poll(uint32_t timeout_ms) {
+    if (!m_hal) return;
+
+    // Put anything the setters queued on the wire
+    ServiceLink();
+    ServiceSync();
+    ServiceCommands();
+
+    // Block for the first chunk, then drain whatever is left (the ring may wrap)
+    if (ReadAndParse(NextWaitMs(timeout_ms)) > 0) {
+        while (ReadAndParse(0) > 0) {
         }
     }
+
+    // Next step right after its predecessor's echo, or a retry on timeout
+    ServiceCommands();
 }
 
-void TuyaHeaterDriver::ProcessPacket(const uint8_t *packet, int len) {
-    if (packet[3] != 0x07) return; // Command Word (0x07 = Status Report)
+void TuyaHeaterDriver::ProcessPacket(const TuyaFrame &packet) {
+    if (packet.Command() == TUYA_CMD_PRODUCT_INFO) {
+        // JSON product string, e.g. {"p":"xxxxxxxx","v":"1.0.0","m":0}
+        char info[65];
+        int n = packet.PayloadLength();
+        if (n > (int)sizeof(info) - 1) n = sizeof(info) - 1;
+        for (int i = 0; i < n; i++) info[i] = (char)packet[6 + i];
+        info[n] = '\0';
+        ESP_LOGI(TAG, "MCU product info: %s", info);
+        return;
+    }
+    if (packet.Command() == TUYA_CMD_HEARTBEAT) {
+        HandleHeartbeatReply(packet);
+        return;
+    }
+    if (packet.Command() != TUYA_CMD_STATUS) { // Command Word (0x07 = Status Report)
+        m_io_stats.unknown_commands++;
+        ESP_LOGD(TAG, "Ignoring command 0x%02x", packet.Command());
+        return;
+    }
     
     int pos = 6;
-    int end = len - 1;
+    int end = packet.Length() - 1;
     bool changed = false;
     
     while (pos < end) {
         if (pos + 4 > end) break;
 
         uint8_t dp_id = packet[pos];
+        uint8_t dp_type = packet[pos+1];
         uint16_t data_len = (packet[pos+2] << 8) | packet[pos+3];
         int val_idx = pos + 4;
         
         if (val_idx + data_len > end) break;
 
-        int32_t val = 0;
-        if (data_len == 1) val = packet[val_idx];
-        else if (data_len == 4) {
-            val = (packet[val_idx] << 24) | (packet[val_idx+1] << 16) | 
-                  (packet[val_idx+2] << 8) | packet[val_idx+3];
+        // Schema lookup: O(1) by id; type byte and width must match the definition
+        const HeaterDpDesc *dp = HeaterSchema::Find(dp_id);
+        if (!dp) {
+            m_io_stats.unknown_dps++;
+            ESP_LOGD(TAG, "Ignoring unknown DP %d", dp_id);
+            pos += 4 + data_len;
+            continue;
         }
-        
-        // --- FACTORY RESET & STATE LOGIC ---
-        if (dp_id == DP_POWER) {
-            bool new_power = (val == 1);
-            if (m_state.power != new_power) {
-                int64_t now = esp_timer_get_time();
-                if (now - last_toggle_time < 3000000) { 
-                    toggle_count++;
-                } else {
-                    toggle_count = 1; 
-                }
-                last_toggle_time = now;
-                
-                ESP_LOGI(TAG, "Power Toggle Detected! Count: %d/10", toggle_count);
-
-                if (toggle_count >= 10) {
-                    ESP_LOGW(TAG, "FACTORY RESET SEQUENCE DETECTED!");
-                    if (m_reset_callback) m_reset_callback();
-                    toggle_count = 0;
-                }
-                m_state.power = new_power; 
-                changed = true; 
-            }
+        if (dp_type != dp->type || data_len != dp->width) {
+            m_io_stats.bad_dps++;
+            ESP_LOGW(TAG, "DP %d: unexpected type %d / len %d", dp_id, dp_type, data_len);
+            pos += 4 + data_len;
+            continue;
         }
-        else if (dp_id == DP_SET_TEMP) {
-            if (m_state.target_temp != val) { m_state.target_temp = val; changed = true; }
-        }
-        else if (dp_id == DP_CUR_TEMP) {
-            if (m_state.current_temp != val) { m_state.current_temp = val; changed = true; }
-        }
-        else if (dp_id == DP_MODE) {
-            if (m_state.mode != val) { m_state.mode = val; changed = true; }
-        }
-        else if (dp_id == DP_SCREEN) {
-            // Inverted Logic: 0=On, 1=Off
-            bool is_on = (val == 0);
-            if (m_state.screen_on != is_on) { 
-                m_state.screen_on = is_on; 
-                changed = true; 
-            }
+
+        uint32_t val = 0;
+        for (int i = 0; i < data_len; i++) val = (val << 8) | packet[val_idx + i];
+
+        if (ConfirmWrite(dp_id, val)) latency_trace_mark(dp_id, LATENCY_STAGE_MCU_ECHO, m_hal->NowUs());
+
+        m_seen_dps |= 1u << HeaterSchema::IndexOf(dp_id);
+        if (dp->store(&m_state, (int32_t)val)) {
+            changed = true;
+            // --- FACTORY RESET LOGIC ---
+            if (dp_id == DP_POWER && m_synced && !OwnPowerWrite()) TrackPowerToggle();
         }
         pos += 4 + data_len;
     }
     
+    if (changed) m_snapshot.Store(m_state);
+
+    // Hold everything back until the first full report; m_state is still
+    // the constructor defaults for any DP not seen yet
+    if (!m_synced) {
+        if (m_seen_dps == (1u << HeaterSchema::kCount) - 1) CompleteSync();
+        return;
+    }
     if (changed) NotifyStateChange();
 }
 
+// A power change we asked for ourselves (controller, automation, local
+// control): queued, in flight, or echoed within the toggle window
+bool TuyaHeaterDriver::OwnPowerWrite() {
+    std::lock_guard<std::mutex> lock(m_cmd_lock);
+    if (m_power_acked_us != 0 && m_hal->NowUs() - m_power_acked_us < TUYA_RESET_WINDOW_MS * 1000LL) return true;
+    for (int i = 0; i < m_cmd_count; i++) {
+        const tuya_pending_cmd_t &cmd = m_cmd_queue[(m_cmd_head + i) % TUYA_CMD_QUEUE_LEN];
+        for (int j = 0; j < cmd.count; j++) {
+            if (cmd.dps[j].dp_id == DP_POWER) return true;
+        }
+    }
+    if (m_batch_open) {
+        for (int j = 0; j < m_batch.count; j++) {
+            if (m_batch.dps[j].dp_id == DP_POWER) return true;
+        }
+    }
+    tuya_quiet_window_t *window = FindQuietWindowLocked(DP_POWER);
+    return window && window->held;
+}
+
+void TuyaHeaterDriver::TrackPowerToggle() {
+    int64_t now = m_hal->NowUs();
+    if (now - last_toggle_time < TUYA_RESET_WINDOW_MS * 1000LL) { 
+        toggle_count++;
+    } else {
+        toggle_count = 1; 
+    }
+    last_toggle_time = now;
+    
+    ESP_LOGI(TAG, "Power Toggle Detected! Count: %d/%d", toggle_count, TUYA_RESET_TOGGLES);
+
+    if (toggle_count >= TUYA_RESET_TOGGLES) {
+        ESP_LOGW(TAG, "FACTORY RESET SEQUENCE DETECTED!");
+        if (m_reset_callback) m_reset_callback(m_reset_ctx);
+        toggle_count = 0;
+    }
+}
+
+tuya_cmd_stats_t TuyaHeaterDriver::GetCommandStats() const {
+    std::lock_guard<std::mutex> lock(m_cmd_lock);
+    return m_cmd_stats;
+}
+
+void TuyaHeaterDriver::GetHealth(tuya_health_t *health) const {
+    const tuya_parser_stats_t &parser = m_parser.GetStats();
+    tuya_cmd_stats_t cmd = GetCommandStats();
+
+    health->bytes_in = m_io_stats.bytes_in;
+    health->bytes_out = m_io_stats.bytes_out;
+    health->frames_ok = parser.frames_ok;
+    health->frames_bad_checksum = parser.frames_bad_checksum;
+    health->resync_bytes = parser.bytes_dropped;
+    health->overflows = parser.overflows + m_io_stats.rx_overruns;
+    health->unknown_dps = m_io_stats.unknown_dps;
+    health->bad_dps = m_io_stats.bad_dps;
+    health->unknown_commands = m_io_stats.unknown_commands;
+    health->frames_sent = m_io_stats.frames_out;
+    health->commands_sent = cmd.frames_sent;
+    health->retries = cmd.retries;
+    health->timeouts = cmd.timeouts;
+}
+
 void TuyaHeaterDriver::NotifyStateChange() {
-    if (m_callback) m_callback(&m_state);
+    if (m_callback) m_callback(&m_state, m_callback_ctx);
 }
 
 void TuyaHeaterDriver::SetPower(bool on) {
-    uint8_t val = on ? 1 : 0;
-    SendCommand(DP_POWER, 0x01, &val, 1);
-    m_state.power = on;
-    NotifyStateChange();
+    Write<DpPower>(on);
 }
 void TuyaHeaterDriver::SetTemp(int temp) {
-    uint8_t val[4];
-    val[0] = (temp >> 24) & 0xFF;
-    val[1] = (temp >> 16) & 0xFF;
-    val[2] = (temp >> 8) & 0xFF;
-    val[3] = temp & 0xFF;
-    SendCommand(DP_SET_TEMP, 0x02, val, 4);
-    m_state.target_temp = temp;
-    NotifyStateChange();
+    Write<DpSetTemp>(temp);
 }
 void TuyaHeaterDriver::SetMode(uint8_t mode) {
-    SendCommand(DP_MODE, 0x04, &mode, 1);
-    m_state.mode = mode;
-    NotifyStateChange();
+    Write<DpMode>(mode);
 }
 
 void TuyaHeaterDriver::SetScreen(bool on) {
-    // Inverted Logic: 0=On, 1=Off
-    uint8_t val = on ? 0 : 1;
-    SendCommand(DP_SCREEN, 0x01, &val, 1);
-    m_state.screen_on = on;
-    NotifyStateChange();
+    // Inverted Logic (0=On, 1=Off) is part of the DpScreen definition
+    Write<DpScreen>(on);
 }
 
-void TuyaHeaterDriver::SetStateCallback(tuya_state_change_cb_t cb) {
+void TuyaHeaterDriver::SetStateCallback(tuya_state_change_cb_t cb, void *ctx) {
     m_callback = cb;
+    m_callback_ctx = ctx;
 }
-void TuyaHeaterDriver::SetResetCallback(tuya_reset_cb_t cb) {
+void TuyaHeaterDriver::SetResetCallback(tuya_reset_cb_t cb, void *ctx) {
     m_reset_callback = cb;
+    m_reset_ctx = ctx;
+}
+void TuyaHeaterDriver::SetLinkCallback(tuya_link_cb_t cb, void *ctx) {
+    m_link_callback = cb;
+    m_link_ctx = ctx;
 }
\ No newline at end of file
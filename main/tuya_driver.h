@@ -3,11 +3,20 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h> // Required for memcpy/memmove
+#include <mutex>
+#include <atomic>
 #include "esp_err.h"
+#include "tuya_dp_schema.h"
+#include "tuya_frame_parser.h"
+#include "tuya_hal.h"
+#include "seqlock.h"
 
-// --- TUYA CONSTANTS ---
-#define TUYA_HEADER_0 0x55
-#define TUYA_HEADER_1 0xAA
+// Tuya MCU command words
+#define TUYA_CMD_HEARTBEAT    0x00
+#define TUYA_CMD_PRODUCT_INFO 0x01
+#define TUYA_CMD_SET_DP       0x06
+#define TUYA_CMD_STATUS       0x07
+#define TUYA_CMD_QUERY_STATUS 0x08
 
 // DP IDs
 #define DP_POWER    1
@@ -21,9 +30,6 @@
 #define MODE_LOW  1
 #define MODE_ECO  2
 
-// Fixed buffer size to avoid Heap allocation (Thread Safe)
-#define RX_BUF_SIZE 512
-
 typedef struct {
     bool power;
     int target_temp;    
@@ -32,45 +38,280 @@ typedef struct {
     bool screen_on;       
 } heater_state_t;
 
-typedef void (*tuya_state_change_cb_t)(const heater_state_t *state);
-typedef void (*tuya_reset_cb_t)(); 
+// --- DATAPOINT SCHEMA ---
+// Decode dispatch and typed encoders are generated from these definitions.
+// New DP: add the state field, one TuyaDp line, and list it in HeaterSchema.
+using DpPower   = TuyaDp<DP_POWER,    TUYA_TYPE_BOOL,  &heater_state_t::power>;
+using DpSetTemp = TuyaDp<DP_SET_TEMP, TUYA_TYPE_VALUE, &heater_state_t::target_temp>;
+using DpCurTemp = TuyaDp<DP_CUR_TEMP, TUYA_TYPE_VALUE, &heater_state_t::current_temp>;
+using DpMode    = TuyaDp<DP_MODE,     TUYA_TYPE_ENUM,  &heater_state_t::mode>;
+using DpScreen  = TuyaDp<DP_SCREEN,   TUYA_TYPE_BOOL,  &heater_state_t::screen_on, true>; // 0=On, 1=Off
+
+using HeaterSchema = TuyaDpSchema<heater_state_t, DpPower, DpSetTemp, DpCurTemp, DpMode, DpScreen>;
+using HeaterDpDesc = TuyaDpDesc<heater_state_t>;
+static_assert(HeaterSchema::kCount <= 32, "DP bitmasks are 32 bits wide");
+
+// Outgoing DP writes waiting for the MCU's 0x07 echo
+#define TUYA_CMD_QUEUE_LEN      8
+#define TUYA_CMD_ACK_TIMEOUT_MS 500
+#define TUYA_CMD_MAX_RETRIES    3
+
+// DP records carried by one 0x06 frame (5 x 8 bytes + header fits 64 bytes)
+#define TUYA_MAX_BATCH_DPS      5
+
+// DPs that may hold back their writes for a quiet window (latest value wins)
+#define TUYA_MAX_QUIET_WINDOWS  4
+
+typedef struct {
+    uint8_t dp_id;
+    uint8_t type;
+    uint8_t len;
+    uint8_t value[4];
+} tuya_dp_write_t;
+
+// One 0x06 frame in the pipeline, done once every DP in it was echoed
+typedef struct {
+    tuya_dp_write_t dps[TUYA_MAX_BATCH_DPS];
+    uint8_t count;
+    uint8_t acked_mask;     // Bit i set once dps[i] was echoed
+    uint8_t retries;
+    bool sent;
+    int64_t sent_at_us;
+} tuya_pending_cmd_t;
+
+typedef struct {
+    uint32_t writes_queued;
+    uint32_t writes_coalesced;  // Superseded before reaching the wire
+    uint32_t frames_sent;       // 0x06 frames incl. retries
+    uint32_t retries;
+    uint32_t timeouts;          // Dropped after TUYA_CMD_MAX_RETRIES
+} tuya_cmd_stats_t;
+
+// A DP with a quiet window is held here, outside the pipeline, so its
+// window never delays other DPs written in the same batch
+typedef struct {
+    uint8_t dp_id;
+    uint32_t quiet_ms;
+    bool held;                  // pending waits for release_us
+    tuya_dp_write_t pending;    // Latest value written
+    int64_t release_us;         // quiet_ms after the latest write
+} tuya_quiet_window_t;
+
+// Counters kept by the driver itself (parser and pipeline keep their own)
+typedef struct {
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint32_t frames_out;        // Every frame written, any command word
+    uint32_t rx_overruns;       // Receiver reported lost bytes
+    uint32_t unknown_dps;       // DP ids not in HeaterSchema
+    uint32_t bad_dps;           // Known DP with unexpected type or length
+    uint32_t unknown_commands;  // Frames with a command word we don't handle
+} tuya_io_stats_t;
+
+// Protocol health snapshot: everything above in one place
+typedef struct {
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    uint32_t frames_ok;
+    uint32_t frames_bad_checksum;
+    uint32_t resync_bytes;      // Skipped while hunting for 55 AA
+    uint32_t overflows;         // Impossible lengths + receiver overruns
+    uint32_t unknown_dps;
+    uint32_t bad_dps;
+    uint32_t unknown_commands;
+    uint32_t frames_sent;       // Every frame written, any command word
+    uint32_t commands_sent;     // 0x06 frames incl. retries
+    uint32_t retries;
+    uint32_t timeouts;
+} tuya_health_t;
+
+// Boot handshake: product info + status query, repeated until the MCU has
+// reported every DP in HeaterSchema at least once
+#define TUYA_SYNC_RETRY_MS      300
+#define TUYA_SYNC_FAST_ATTEMPTS 10
+#define TUYA_SYNC_SLOW_RETRY_MS 5000
+
+// Link liveness via the Tuya 0x00 heartbeat: slow while the MCU answers,
+// fast probes once a reply is missed
+#define TUYA_HB_HEALTHY_MS       15000
+#define TUYA_HB_FAST_MS          1000
+#define TUYA_HB_REPLY_TIMEOUT_MS 500
+#define TUYA_HB_MISSES_DOWN      3
+
+// A damaged frame may have been a state report: re-query, at most this often
+#define TUYA_RECOVER_QUERY_MS    1000
+
+// Factory reset: this many physical power toggles, each within the window of
+// the previous one
+#define TUYA_RESET_TOGGLES       10
+#define TUYA_RESET_WINDOW_MS     3000
+
+typedef enum {
+    TUYA_LINK_UNKNOWN,      // No heartbeat answered yet
+    TUYA_LINK_UP,
+    TUYA_LINK_DEGRADED,     // Missed heartbeat replies, probing fast
+    TUYA_LINK_DOWN,         // TUYA_HB_MISSES_DOWN replies in a row missed
+    TUYA_LINK_RESYNC,       // MCU rebooted, waiting for its fresh state
+} tuya_link_state_t;
+
+// What the MCU's first heartbeat reply said about its uptime
+typedef enum {
+    TUYA_MCU_BOOT_UNKNOWN,  // Not answered yet
+    TUYA_MCU_BOOT_FRESH,    // 0x00: just powered up, its state is the power-on default
+    TUYA_MCU_BOOT_RUNNING,  // 0x01: was already running, its state is current
+} tuya_mcu_boot_t;
+
+// ctx is the pointer given with the callback, e.g. the owner of one of
+// several drivers
+typedef void (*tuya_state_change_cb_t)(const heater_state_t *state, void *ctx);
+typedef void (*tuya_reset_cb_t)(void *ctx);
+typedef void (*tuya_link_cb_t)(tuya_link_state_t state, void *ctx);
 
 class TuyaHeaterDriver {
 public:
     TuyaHeaterDriver();
 
-    esp_err_t Init(int tx_pin, int rx_pin);
-    void Poll();
-    void SendHeartbeat();
+    // The HAL must already be open and outlive the driver. Starts the boot
+    // handshake right away; no state is published until it completes.
+    esp_err_t Init(TuyaHal *hal);
+
+    // Waits at most timeout_ms for RX data (less if a command, handshake step
+    // or heartbeat is due), parses every complete frame and advances the
+    // command pipeline, boot handshake and link monitor.
+    void Poll(uint32_t timeout_ms = 50);
+
+    // timeout_ms, shortened to when Poll() next has work due (0 = now). Lets
+    // one task block for several drivers and call Poll(0) when needed.
+    uint32_t NextWaitMs(uint32_t timeout_ms);
 
-    // Setters
+    // One-off full status query (0x08)
+    void RequestStatus();
+
+    // Setters: queue the DP write and return immediately. m_state only
+    // changes once the MCU echoes the DP back in a 0x07 report.
     void SetPower(bool on);
     void SetMode(uint8_t mode);
     void SetTemp(int temp);
     void SetPowerAndMode(bool on, uint8_t mode);
     void SetScreen(bool on);
 
-    void SetStateCallback(tuya_state_change_cb_t cb);
-    void SetResetCallback(tuya_reset_cb_t cb);
+    // Typed write of any DP in HeaterSchema (value encoded per its definition).
+    // ordered: never merged into a frame queued ahead of this call.
+    template <typename Dp>
+    void Write(typename Dp::value_type value, bool ordered = false) {
+        static_assert(HeaterSchema::Contains<Dp>(), "DP is not part of HeaterSchema");
+        uint8_t buf[4];
+        int len = Dp::Encode(value, buf);
+        QueueWrite(Dp::id, Dp::type, buf, len, ordered);
+    }
+
+    // Batched writes: setters called between BeginBatch() and CommitBatch()
+    // go out as one 0x06 frame carrying every DP record.
+    void BeginBatch();
+    void CommitBatch();
+
+    // Hold writes to dp_id until no newer value arrived for quiet_ms; only
+    // the latest value is sent, in a frame of its own. Other DPs, batched
+    // or not, go out right away. 0 disables the window for that DP.
+    void SetCoalesceWindow(uint8_t dp_id, uint32_t quiet_ms);
+
+    void SetStateCallback(tuya_state_change_cb_t cb, void *ctx = nullptr);
+    void SetResetCallback(tuya_reset_cb_t cb, void *ctx = nullptr);
+    void SetLinkCallback(tuya_link_cb_t cb, void *ctx = nullptr);
 
-    heater_state_t GetState() const { return m_state; }
+    // Consistent copy of the last MCU-reported state, safe from any task
+    // without locking (m_state itself belongs to the Poll() task)
+    heater_state_t GetState() const { return m_snapshot.Load(); }
+    // True once the MCU has reported the full state since boot
+    bool IsSynced() const { return m_synced.load(std::memory_order_relaxed); }
+    // Set by the first heartbeat reply after our boot, and again whenever the
+    // MCU restarts. Usually arrives just after the handshake has completed.
+    tuya_mcu_boot_t GetMcuBoot() const { return m_mcu_boot.load(std::memory_order_relaxed); }
+    tuya_link_state_t GetLinkState() const { return m_link_state.load(std::memory_order_relaxed); }
+    const tuya_parser_stats_t &GetParserStats() const { return m_parser.GetStats(); }
+    // Copy taken under the command lock: the setters' tasks count too
+    tuya_cmd_stats_t GetCommandStats() const;
+    // Parser and I/O counters are only written by the Poll() task; read from
+    // another task they may be a few increments behind but never torn. The
+    // command counters are copied under the command lock.
+    void GetHealth(tuya_health_t *health) const;
 
 private:
     heater_state_t m_state;
+    SeqLock<heater_state_t> m_snapshot;     // Published copy of m_state
     tuya_state_change_cb_t m_callback;
     tuya_reset_cb_t m_reset_callback; 
+    tuya_link_cb_t m_link_callback;
+    void *m_callback_ctx;
+    void *m_reset_ctx;
+    void *m_link_ctx;
     
-    int m_uart_num;
+    TuyaHal *m_hal;
     
-    // --- MEMORY FIX: FIXED ARRAY INSTEAD OF VECTOR ---
-    uint8_t rx_buffer[RX_BUF_SIZE];
-    int rx_count;
+    // Zero-copy RX ring + incremental frame decoder (no heap)
+    TuyaFrameParser m_parser;
+
+    // Command pipeline (ring of pending writes, head is the one in flight).
+    // Filled from the Matter thread, drained by the task calling Poll().
+    mutable std::mutex m_cmd_lock;
+    tuya_pending_cmd_t m_cmd_queue[TUYA_CMD_QUEUE_LEN];
+    int m_cmd_head;
+    int m_cmd_count;
+    tuya_pending_cmd_t m_batch;
+    bool m_batch_open;
+    bool m_batch_ordered;   // Batch started with an ordered write
+    tuya_cmd_stats_t m_cmd_stats;
+    tuya_io_stats_t m_io_stats;
+    tuya_quiet_window_t m_quiet_windows[TUYA_MAX_QUIET_WINDOWS];
+
+    // Boot handshake. m_synced, m_link_state and m_mcu_boot are written by
+    // the Poll() task and read from any task.
+    std::atomic<bool> m_synced;
+    uint32_t m_seen_dps;        // Bit per HeaterSchema index reported so far
+    int m_sync_attempts;
+    int64_t m_sync_started_us;
+    int64_t m_next_sync_us;
+
+    // Link monitor
+    std::atomic<tuya_link_state_t> m_link_state;
+    bool m_hb_outstanding;
+    bool m_hb_answered;         // MCU has answered at least once since our boot
+    std::atomic<tuya_mcu_boot_t> m_mcu_boot;
+    int m_hb_missed;
+    int64_t m_hb_deadline_us;   // Reply due (outstanding) or next heartbeat due
+
+    // Lost-report recovery
+    uint32_t m_rx_damage_seen;  // bad checksums + dropped bytes already handled
+    int64_t m_recover_query_us;
 
     // Reset Detection Variables
     int64_t last_toggle_time;
     int toggle_count;
+    int64_t m_power_acked_us;   // Last echo of our own DP_POWER write
 
-    void ProcessPacket(const uint8_t *data, int len);
-    void SendCommand(uint8_t dp_id, uint8_t type, const uint8_t *value, int len);
+    int ReadAndParse(uint32_t timeout_ms);
+    void ProcessPacket(const TuyaFrame &packet);
+    void SendFrame(uint8_t command, const uint8_t *payload, int len);
+    void SendCommand(const tuya_pending_cmd_t &cmd);
+    void StartSync();
+    void ServiceSync();
+    void CompleteSync();
+    uint32_t SyncWaitMs(uint32_t timeout_ms);
+    void ServiceLink();
+    void HandleHeartbeatReply(const TuyaFrame &packet);
+    void SetLinkState(tuya_link_state_t state);
+    uint32_t LinkWaitMs(uint32_t timeout_ms);
+    void QueueWrite(uint8_t dp_id, uint8_t type, const uint8_t *value, int len, bool ordered = false);
+    bool CoalesceLocked(const tuya_dp_write_t &dp, bool ordered);
+    void EnqueueLocked(tuya_pending_cmd_t &cmd, bool ordered);
+    // True if the in-flight frame wrote exactly this value to dp_id
+    bool ConfirmWrite(uint8_t dp_id, uint32_t value);
+    void ServiceCommands();
+    uint32_t CommandWaitMs(uint32_t timeout_ms);
+    tuya_quiet_window_t *FindQuietWindowLocked(uint8_t dp_id);
+    void ReleaseQuietWindowsLocked(int64_t now);
+    void RecoverLostReport();
+    bool OwnPowerWrite();
+    void TrackPowerToggle();
     void NotifyStateChange();
 };
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include "tuya_frame_parser.h"
+#include <string.h>
+
+TuyaFrameParser::TuyaFrameParser() {
+    memset(m_ring, 0, sizeof(m_ring));
+    memset(&m_stats, 0, sizeof(m_stats));
+    Reset();
+}
+
+void TuyaFrameParser::Reset() {
+    m_head = 0;
+    m_tail = 0;
+    m_scan = 0;
+    m_state = WAIT_HEADER_0;
+    m_checksum = 0;
+    m_payload_len = 0;
+    m_remaining = 0;
+    m_frame_pending = false;
+}
+
+void TuyaFrameParser::Discard() {
+    m_stats.bytes_dropped += m_head - m_tail;
+    Reset();
+}
+
+uint8_t *TuyaFrameParser::WritePtr(size_t *space) {
+    uint32_t used = m_head - m_tail;
+    uint32_t free_space = TUYA_RX_RING_SIZE - used;
+    uint32_t offset = m_head & TUYA_RX_RING_MASK;
+    uint32_t contiguous = TUYA_RX_RING_SIZE - offset;
+
+    *space = (free_space < contiguous) ? free_space : contiguous;
+    return &m_ring[offset];
+}
+
+void TuyaFrameParser::Commit(size_t len) {
+    m_head += len;
+}
+
+size_t TuyaFrameParser::Feed(const uint8_t *data, size_t len) {
+    size_t accepted = 0;
+    while (accepted < len) {
+        size_t space;
+        uint8_t *dst = WritePtr(&space);
+        if (space == 0) break;
+        if (space > len - accepted) space = len - accepted;
+        memcpy(dst, &data[accepted], space);
+        Commit(space);
+        accepted += space;
+    }
+    return accepted;
+}
+
+void TuyaFrameParser::Drop(uint32_t new_tail) {
+    m_stats.bytes_dropped += new_tail - m_tail;
+    m_tail = new_tail;
+}
+
+// The 55 AA at m_tail was not a real frame. Only that byte is discarded; the
+// rest is scanned again, so a genuine frame hiding behind a header faked by
+// line noise is still found.
+void TuyaFrameParser::Reject() {
+    Drop(m_tail + 1);
+    m_scan = m_tail;
+    m_state = WAIT_HEADER_0;
+}
+
+bool TuyaFrameParser::Next(TuyaFrame *frame) {
+    // Release the frame handed out by the previous call
+    if (m_frame_pending) {
+        m_tail = m_scan;
+        m_frame_pending = false;
+    }
+
+    while (m_scan != m_head) {
+        uint8_t b = m_ring[m_scan & TUYA_RX_RING_MASK];
+        m_scan++;
+
+        switch (m_state) {
+        case WAIT_HEADER_0:
+            if (b == TUYA_HEADER_0) {
+                m_state = WAIT_HEADER_1;
+            } else {
+                Drop(m_scan);
+            }
+            break;
+
+        case WAIT_HEADER_1:
+            if (b == TUYA_HEADER_1) {
+                m_checksum = TUYA_HEADER_0 + TUYA_HEADER_1;
+                m_state = READ_VERSION;
+            } else if (b == TUYA_HEADER_0) {
+                // Previous 0x55 was noise, this one may start the real frame
+                Drop(m_scan - 1);
+            } else {
+                Drop(m_scan);
+                m_state = WAIT_HEADER_0;
+            }
+            break;
+
+        case READ_VERSION:
+            m_checksum += b;
+            m_state = READ_COMMAND;
+            break;
+
+        case READ_COMMAND:
+            m_checksum += b;
+            m_state = READ_LEN_HI;
+            break;
+
+        case READ_LEN_HI:
+            m_checksum += b;
+            m_payload_len = (uint16_t)(b << 8);
+            m_state = READ_LEN_LO;
+            break;
+
+        case READ_LEN_LO:
+            m_checksum += b;
+            m_payload_len |= b;
+            if (m_payload_len > TUYA_MAX_PAYLOAD) {
+                // A false header. Throw it away and hunt for the next one.
+                m_stats.overflows++;
+                Reject();
+            } else {
+                m_remaining = m_payload_len;
+                m_state = (m_remaining > 0) ? READ_PAYLOAD : READ_CHECKSUM;
+            }
+            break;
+
+        case READ_PAYLOAD:
+            m_checksum += b;
+            if (--m_remaining == 0) m_state = READ_CHECKSUM;
+            break;
+
+        case READ_CHECKSUM:
+            m_state = WAIT_HEADER_0;
+            if (b == m_checksum) {
+                m_stats.frames_ok++;
+                frame->m_ring = m_ring;
+                frame->m_start = m_tail;
+                frame->m_len = (int)(m_scan - m_tail);
+                m_frame_pending = true;
+                return true;
+            }
+            m_stats.frames_bad_checksum++;
+            Reject();
+            break;
+        }
+    }
+    return false;
+}
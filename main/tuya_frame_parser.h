@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- TUYA FRAME LAYOUT ---
+// 55 AA | VER | CMD | LEN_HI LEN_LO | PAYLOAD... | CHECKSUM
+#define TUYA_HEADER_0 0x55
+#define TUYA_HEADER_1 0xAA
+#define TUYA_FRAME_OVERHEAD 7
+
+// Ring capacity (must be a power of two so indices wrap with a mask)
+#define TUYA_RX_RING_SIZE 512
+#define TUYA_RX_RING_MASK (TUYA_RX_RING_SIZE - 1)
+
+// Largest payload that still fits the ring as one frame
+#define TUYA_MAX_PAYLOAD (TUYA_RX_RING_SIZE - TUYA_FRAME_OVERHEAD)
+
+static_assert((TUYA_RX_RING_SIZE & TUYA_RX_RING_MASK) == 0, "TUYA_RX_RING_SIZE must be a power of two");
+
+typedef struct {
+    uint32_t frames_ok;
+    uint32_t frames_bad_checksum;   // Includes false headers found inside a rejected frame
+    uint32_t bytes_dropped;     // Garbage skipped while hunting for 55 AA (incl. rejected frames)
+    uint32_t overflows;         // Headers announcing a payload that can never fit the ring
+} tuya_parser_stats_t;
+
+// Zero-copy view of one complete frame. It indexes straight into the parser
+// ring and stays valid until the next call to TuyaFrameParser::Next().
+class TuyaFrame {
+public:
+    TuyaFrame() : m_ring(nullptr), m_start(0), m_len(0) {}
+
+    uint8_t operator[](int i) const { return m_ring[(m_start + i) & TUYA_RX_RING_MASK]; }
+
+    int Length() const { return m_len; }
+    uint8_t Version() const { return (*this)[2]; }
+    uint8_t Command() const { return (*this)[3]; }
+    int PayloadLength() const { return m_len - TUYA_FRAME_OVERHEAD; }
+
+private:
+    friend class TuyaFrameParser;
+
+    const uint8_t *m_ring;
+    uint32_t m_start;
+    int m_len;
+};
+
+// Incremental Tuya MCU frame decoder.
+//
+// Received bytes are written straight into the ring (WritePtr/Commit) and
+// inspected by a small state machine that tracks the header, length and a
+// running checksum. Garbage costs O(1) per byte. After a rejected frame (bad
+// checksum or impossible length) only its first byte is dropped and the rest
+// is rescanned, so a corrupt or fake header never takes real frames down with
+// it; a byte is rescanned at most once per false header in front of it, which
+// the ring size bounds. Only the frame currently being assembled is retained,
+// so the ring can never fill up with valid traffic.
+class TuyaFrameParser {
+public:
+    TuyaFrameParser();
+
+    // Contiguous free region at the write position. *space is 0 only when
+    // frames were left undrained: once Next() has returned false, at most
+    // one incomplete frame is retained, and that is shorter than the ring.
+    uint8_t *WritePtr(size_t *space);
+
+    // Publish `len` bytes written at WritePtr().
+    void Commit(size_t len);
+
+    // Copy bytes into the ring. Returns how many were accepted.
+    size_t Feed(const uint8_t *data, size_t len);
+
+    // Parse pending bytes. Returns true and fills *frame for every complete,
+    // checksum-valid frame. The previous frame is released on each call.
+    bool Next(TuyaFrame *frame);
+
+    void Reset();
+    // Reset, counting whatever was retained as dropped
+    void Discard();
+
+    // Bytes committed but not yet consumed (frame in progress or undrained)
+    size_t Pending() const { return m_head - m_tail; }
+
+    const tuya_parser_stats_t &GetStats() const { return m_stats; }
+
+private:
+    enum State : uint8_t {
+        WAIT_HEADER_0,
+        WAIT_HEADER_1,
+        READ_VERSION,
+        READ_COMMAND,
+        READ_LEN_HI,
+        READ_LEN_LO,
+        READ_PAYLOAD,
+        READ_CHECKSUM,
+    };
+
+    void Drop(uint32_t new_tail);
+    void Reject();
+
+    uint8_t m_ring[TUYA_RX_RING_SIZE];
+
+    // Free-running indices, masked on access
+    uint32_t m_head;    // Next byte written by the receiver
+    uint32_t m_tail;    // First byte still owned by the parser
+    uint32_t m_scan;    // Next byte to run through the state machine
+
+    State m_state;
+    uint8_t m_checksum;
+    uint16_t m_payload_len;
+    uint16_t m_remaining;
+    bool m_frame_pending;
+
+    tuya_parser_stats_t m_stats;
+};
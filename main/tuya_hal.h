@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Transmit priority of a whole frame, most urgent first
+typedef enum {
+    TUYA_TX_PRIO_COMMAND,       // DP writes: user actions
+    TUYA_TX_PRIO_QUERY,         // Status and product info queries
+    TUYA_TX_PRIO_HEARTBEAT,
+    TUYA_TX_PRIO_COUNT
+} tuya_tx_prio_t;
+
+// Platform layer under TuyaHeaterDriver: serial link, monotonic clock, delay.
+// The driver never touches uart_* / esp_timer / vTaskDelay directly, so it can
+// run against any byte stream (ESP UART, POSIX tty/pty, replayed captures).
+class TuyaHal {
+public:
+    virtual ~TuyaHal() {}
+
+    // Wait at most timeout_ms for RX data and copy up to max_len bytes.
+    // Returns bytes read, 0 on timeout, or -1 if the receiver lost data.
+    virtual int Read(uint8_t *dst, size_t max_len, uint32_t timeout_ms) = 0;
+
+    // Queue bytes for transmission. Returns bytes accepted.
+    virtual int Write(const uint8_t *data, size_t len) = 0;
+
+    // One complete frame. HALs with a transmit queue return at once and send
+    // more urgent frames first; the default writes it in place. Returns bytes
+    // accepted, or -1 if the frame was dropped.
+    virtual int WriteFrame(const uint8_t *frame, size_t len, tuya_tx_prio_t prio) { return Write(frame, len); }
+
+    // Monotonic time since boot
+    virtual int64_t NowUs() = 0;
+
+    virtual void DelayMs(uint32_t ms) = 0;
+
+    // Make a Read() blocked in another task return early. Only needed by
+    // HALs that can block longer than the driver's own deadlines.
+    virtual void Wake() {}
+};
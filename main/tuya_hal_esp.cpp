@@ -0,0 +1,260 @@
+#include "tuya_hal_esp.h"
+#include <esp_log.h>
+#include <stdio.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#if CONFIG_PM_ENABLE
+#include <esp_sleep.h>
+#endif
+
+static const char *TAG = "TUYA_HAL";
+
+#define BAUD_RATE 9600
+
+// Event-driven RX: raise UART_DATA once the line has been idle this many
+// symbol times (~3 ms at 9600 baud), i.e. right after a frame has finished.
+#define RX_IDLE_TIMEOUT_SYMBOLS 3
+
+// Stay out of light sleep this long after RX data (the MCU often sends
+// several frames back to back) and after a write (covers the echo/reply)
+#define AWAKE_AFTER_RX_MS 100
+#define AWAKE_AFTER_TX_MS 600
+
+// Minimum idle time on the line between two frames, so the MCU has finished
+// parsing one before the next starts
+#define TX_FRAME_GAP_MS 10
+
+static uart_config_t make_uart_config(uart_sclk_t source_clk) {
+    uart_config_t uart_config = {
+        .baud_rate = BAUD_RATE,
+        .data_bits = UART_DATA_8_BITS,
+        .parity    = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = source_clk,
+    };
+    return uart_config;
+}
+
+EspUartHal::EspUartHal(uart_port_t uart_num) {
+    m_uart_num = uart_num;
+    m_uart_queue = nullptr;
+    m_in_set = false;
+    m_overflowed = false;
+    m_tx_task = nullptr;
+    m_tx_idle_us = 0;
+#if CONFIG_PM_ENABLE
+    m_awake_lock = nullptr;
+    m_awake_held = false;
+    m_awake_until_us = 0;
+#endif
+}
+
+esp_err_t EspUartHal::Open(int tx_pin, int rx_pin, bool event_driven) {
+    uart_config_t uart_config = make_uart_config(UART_SCLK_DEFAULT);
+
+    // Install UART driver with internal buffer (buffer size x2)
+    esp_err_t err;
+    if (event_driven) {
+        err = uart_driver_install(m_uart_num, 1024, 0, UART_EVENT_QUEUE_LEN, &m_uart_queue, 0);
+    } else {
+        err = uart_driver_install(m_uart_num, 1024, 0, 0, NULL, 0);
+    }
+    if (err != ESP_OK) return err;
+    
+    err = uart_param_config(m_uart_num, &uart_config);
+    if (err != ESP_OK) return err;
+    
+    err = uart_set_pin(m_uart_num, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    if (err != ESP_OK) return err;
+
+    if (event_driven) {
+        // Pattern detection on 0x55 is not usable here: the byte also shows up
+        // inside payloads and checksums. The RX idle timeout marks frame ends.
+        err = uart_set_rx_timeout(m_uart_num, RX_IDLE_TIMEOUT_SYMBOLS);
+        if (err != ESP_OK) return err;
+    }
+
+    // No TX ring buffer: uart_write_bytes blocks for ~1 ms per byte, which
+    // only the writer task ever waits out
+    char name[configMAX_TASK_NAME_LEN];
+    snprintf(name, sizeof(name), "tuya_tx%d", (int)m_uart_num);
+    m_tx_task = xTaskCreateStatic(TxTask, name, UART_TX_TASK_STACK, this, UART_TX_TASK_PRIO, m_tx_stack, &m_tx_task_buffer);
+    return m_tx_task ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t EspUartHal::EnableSleepWakeup(int wakeup_threshold) {
+#if CONFIG_PM_ENABLE
+    // The APB-derived clock changes with DFS; XTAL keeps the baud rate exact
+    uart_config_t uart_config = make_uart_config(UART_SCLK_XTAL);
+    esp_err_t err = uart_param_config(m_uart_num, &uart_config);
+    if (err != ESP_OK) return err;
+
+    err = uart_set_wakeup_threshold(m_uart_num, wakeup_threshold);
+    if (err != ESP_OK) return err;
+    err = esp_sleep_enable_uart_wakeup(m_uart_num);
+    if (err != ESP_OK) return err;
+
+    return esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "tuya_uart", &m_awake_lock);
+#else
+    (void)wakeup_threshold;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+#if CONFIG_PM_ENABLE
+void EspUartHal::HoldAwake(uint32_t ms) {
+    if (!m_awake_lock) return;
+    if (!m_awake_held) {
+        esp_pm_lock_acquire(m_awake_lock);
+        m_awake_held = true;
+    }
+    int64_t until = esp_timer_get_time() + (int64_t)ms * 1000;
+    if (until > m_awake_until_us) m_awake_until_us = until;
+}
+
+// Clamp the RX wait to the end of the awake window, releasing it once over
+uint32_t EspUartHal::AwakeWaitMs(uint32_t timeout_ms) {
+    if (!m_awake_held) return timeout_ms;
+
+    int64_t remaining_us = m_awake_until_us - esp_timer_get_time();
+    if (remaining_us <= 0) {
+        esp_pm_lock_release(m_awake_lock);
+        m_awake_held = false;
+        return timeout_ms;
+    }
+    uint32_t remaining_ms = (uint32_t)((remaining_us + 999) / 1000);
+    return (remaining_ms < timeout_ms) ? remaining_ms : timeout_ms;
+}
+#endif
+
+uint32_t EspUartHal::MaxWaitMs(uint32_t timeout_ms) {
+#if CONFIG_PM_ENABLE
+    return AwakeWaitMs(timeout_ms);
+#else
+    return timeout_ms;
+#endif
+}
+
+int EspUartHal::Read(uint8_t *dst, size_t max_len, uint32_t timeout_ms) {
+    timeout_ms = MaxWaitMs(timeout_ms);
+    if (!m_uart_queue) {
+        return uart_read_bytes(m_uart_num, dst, max_len, ms_to_ticks_ceil(timeout_ms));
+    }
+
+    if (m_overflowed) {
+        m_overflowed = false;
+        return -1;
+    }
+
+    // Events are only wake-ups: anything already buffered is returned at once
+    size_t buffered = 0;
+    uart_get_buffered_data_len(m_uart_num, &buffered);
+    if (buffered == 0) {
+        if (m_in_set) return 0; // The set's owner does the waiting
+
+        uart_event_t event;
+        if (xQueueReceive(m_uart_queue, &event, ms_to_ticks_ceil(timeout_ms)) != pdTRUE) return 0;
+
+        if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+            ESP_LOGW(TAG, "UART RX overflow, flushing");
+            uart_flush_input(m_uart_num);
+            xQueueReset(m_uart_queue);
+            return -1;
+        }
+        uart_get_buffered_data_len(m_uart_num, &buffered);
+        if (buffered == 0) return 0;
+    }
+
+    if (buffered > max_len) buffered = max_len;
+#if CONFIG_PM_ENABLE
+    HoldAwake(AWAKE_AFTER_RX_MS);
+#endif
+    return uart_read_bytes(m_uart_num, dst, buffered, 0);
+}
+
+int EspUartHal::Write(const uint8_t *data, size_t len) {
+#if CONFIG_PM_ENABLE
+    HoldAwake(AWAKE_AFTER_TX_MS);
+#endif
+    return uart_write_bytes(m_uart_num, (const char*)data, len);
+}
+
+int EspUartHal::WriteFrame(const uint8_t *frame, size_t len, tuya_tx_prio_t prio) {
+    if (!m_tx_task) return Write(frame, len);
+#if CONFIG_PM_ENABLE
+    HoldAwake(AWAKE_AFTER_TX_MS);
+#endif
+    if (!m_tx_queue.Push(frame, len, prio, esp_timer_get_time())) {
+        ESP_LOGD(TAG, "UART%d TX queue full, frame dropped", (int)m_uart_num);
+        return -1;
+    }
+    xTaskNotifyGive(m_tx_task);
+    return (int)len;
+}
+
+void EspUartHal::TxTask(void *arg) {
+    static_cast<EspUartHal *>(arg)->RunTx();
+}
+
+void EspUartHal::RunTx() {
+    tuya_tx_frame_t frame;
+    while (1) {
+        if (m_tx_queue.Depth() == 0) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        // Spacing before picking the frame, so one queued meanwhile can
+        // still overtake if it is more urgent. One sleep covers the rest of
+        // the gap; the first tick only ends the current one, hence the +1.
+        int64_t gap_left_us = m_tx_idle_us + TX_FRAME_GAP_MS * 1000LL - esp_timer_get_time();
+        if (gap_left_us > 0) {
+            vTaskDelay(ms_to_ticks_ceil((uint32_t)((gap_left_us + 999) / 1000)) + 1);
+            continue;
+        }
+        if (!m_tx_queue.Pop(&frame, esp_timer_get_time())) continue;
+
+        uart_write_bytes(m_uart_num, (const char *)frame.data, frame.len);
+        uart_wait_tx_done(m_uart_num, portMAX_DELAY);
+        m_tx_idle_us = esp_timer_get_time();
+    }
+}
+
+int64_t EspUartHal::NowUs() {
+    return esp_timer_get_time();
+}
+
+void EspUartHal::DelayMs(uint32_t ms) {
+    vTaskDelay(ms_to_ticks_ceil(ms));
+}
+
+esp_err_t EspUartHal::JoinQueueSet(QueueSetHandle_t set) {
+    if (!m_uart_queue) return ESP_ERR_INVALID_STATE;
+    // Only an empty queue can join; buffered bytes are still read on the first pass
+    xQueueReset(m_uart_queue);
+    if (xQueueAddToSet(m_uart_queue, set) != pdPASS) return ESP_FAIL;
+    m_in_set = true;
+    return ESP_OK;
+}
+
+// Every event selected from the set is received here and nowhere else, so the
+// set never holds handles of events that were already consumed
+void EspUartHal::TakeEvent() {
+    uart_event_t event;
+    if (xQueueReceive(m_uart_queue, &event, 0) != pdTRUE) return;
+
+    if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+        ESP_LOGW(TAG, "UART%d RX overflow, flushing", (int)m_uart_num);
+        uart_flush_input(m_uart_num);
+        m_overflowed = true;
+    }
+}
+
+void EspUartHal::Wake() {
+    if (!m_uart_queue) return; // Polled reads time out on their own
+
+    // Reader treats any non-overflow event as a plain wake-up
+    uart_event_t event = {};
+    event.type = UART_EVENT_MAX;
+    xQueueSend(m_uart_queue, &event, 0);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "tuya_hal.h"
+#include "tuya_tx_queue.h"
+#include "esp_err.h"
+#include <driver/uart.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "sdkconfig.h"
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+
+// Ticks for a wait of ms, rounded up. pdMS_TO_TICKS truncates, so at
+// 100 Hz any wait under 10 ms would become a non-blocking spin.
+static inline TickType_t ms_to_ticks_ceil(uint32_t ms) {
+    if (ms == portMAX_DELAY) return portMAX_DELAY;
+    return (TickType_t)(((uint64_t)ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
+// UART driver events buffered per port in event-driven mode
+#define UART_EVENT_QUEUE_LEN    16
+
+// Per-port writer task draining the TX queue (stack in bytes, static)
+#define UART_TX_TASK_STACK      2048
+#define UART_TX_TASK_PRIO       6
+
+// TuyaHal on top of the ESP-IDF UART driver, esp_timer and FreeRTOS.
+class EspUartHal : public TuyaHal {
+public:
+    explicit EspUartHal(uart_port_t uart_num);
+
+    // event_driven: block on the UART driver's event queue (woken when the line
+    // goes idle after a frame) instead of polling uart_read_bytes. Starts the
+    // port's writer task in both modes, so WriteFrame() only queues the frame
+    // and never waits for the wire.
+    esp_err_t Open(int tx_pin, int rx_pin, bool event_driven = false);
+    bool IsEventDriven() const { return m_uart_queue != nullptr; }
+    uart_port_t Port() const { return m_uart_num; }
+    // Event queue Read() blocks on (null if polled), for a caller that
+    // waits on several ports at once
+    QueueHandle_t EventQueue() const { return m_uart_queue; }
+    // Hands the event queue to a queue set shared with other ports. From then
+    // on the set's owner calls TakeEvent() for every event it selects, and
+    // Read() only returns data already buffered (never blocks).
+    esp_err_t JoinQueueSet(QueueSetHandle_t set);
+    void TakeEvent();
+    // timeout_ms, clamped to the end of the current awake window; releases
+    // the no-sleep lock once that window is over
+    uint32_t MaxWaitMs(uint32_t timeout_ms);
+
+    // Light-sleep support (call after Open). RX edges wake the chip, and a
+    // no-sleep lock is held from the first byte or write until the exchange
+    // has gone quiet, so the rest of the frame is not lost to sleep.
+    esp_err_t EnableSleepWakeup(int wakeup_threshold);
+
+    int Read(uint8_t *dst, size_t max_len, uint32_t timeout_ms) override;
+    int Write(const uint8_t *data, size_t len) override;
+    int WriteFrame(const uint8_t *frame, size_t len, tuya_tx_prio_t prio) override;
+    void GetTxStats(tuya_tx_stats_t *stats) { m_tx_queue.GetStats(stats); }
+    int64_t NowUs() override;
+    void DelayMs(uint32_t ms) override;
+    void Wake() override;
+
+private:
+    uart_port_t m_uart_num;
+    QueueHandle_t m_uart_queue; // Only set in event-driven mode
+    bool m_in_set;
+    bool m_overflowed;          // Seen by TakeEvent(), not yet reported by Read()
+
+    TuyaTxQueue m_tx_queue;
+    TaskHandle_t m_tx_task;
+    StaticTask_t m_tx_task_buffer;
+    StackType_t m_tx_stack[UART_TX_TASK_STACK];
+    int64_t m_tx_idle_us;       // Writer only: when the last frame left the wire
+
+    static void TxTask(void *arg);
+    void RunTx();
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t m_awake_lock;  // Only set once sleep wakeup is enabled
+    bool m_awake_held;
+    int64_t m_awake_until_us;
+
+    void HoldAwake(uint32_t ms);
+    uint32_t AwakeWaitMs(uint32_t timeout_ms);
+#endif
+};
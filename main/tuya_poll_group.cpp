@@ -0,0 +1,115 @@
+#include "tuya_poll_group.h"
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/task.h>
+#include <string.h>
+
+static const char *TAG = "TUYA_POLL_GROUP";
+
+TuyaPollGroup::TuyaPollGroup() : m_reset_requested(false) {
+    memset(m_members, 0, sizeof(m_members));
+    m_count = 0;
+    m_polled_member = false;
+    m_set = nullptr;
+    ClearStats(0);
+}
+
+esp_err_t TuyaPollGroup::Add(TuyaHeaterDriver *driver, EspUartHal *hal, tuya_after_poll_cb_t after_poll, void *ctx) {
+    if (m_count == TUYA_POLL_GROUP_MAX) return ESP_ERR_NO_MEM;
+    member_t &m = m_members[m_count++];
+    m.driver = driver;
+    m.hal = hal;
+    m.after_poll = after_poll;
+    m.ctx = ctx;
+    if (!hal->IsEventDriven()) m_polled_member = true;
+    return ESP_OK;
+}
+
+bool TuyaPollGroup::GetTxStats(int index, tuya_tx_stats_t *stats) {
+    if (index < 0 || index >= m_count) return false;
+    m_members[index].hal->GetTxStats(stats);
+    return true;
+}
+
+void TuyaPollGroup::ClearStats(int64_t now) {
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.members = m_count;
+    m_stats.since_us = now;
+    for (int i = 0; i < m_count; i++) {
+        m_stats.member[i].port = (int)m_members[i].hal->Port();
+    }
+    m_published.Store(m_stats);
+}
+
+// Shortest wait any member allows, never longer than idle_timeout_ms
+uint32_t TuyaPollGroup::WaitMs(uint32_t idle_timeout_ms) {
+    uint32_t wait = m_polled_member ? TUYA_POLL_INTERVAL_MS : idle_timeout_ms;
+    for (int i = 0; i < m_count; i++) {
+        wait = m_members[i].hal->MaxWaitMs(m_members[i].driver->NextWaitMs(wait));
+    }
+    return wait;
+}
+
+void TuyaPollGroup::Run(uint32_t idle_timeout_ms) {
+    int queues = 0;
+    for (int i = 0; i < m_count; i++) {
+        if (m_members[i].hal->IsEventDriven()) queues++;
+    }
+    if (queues > 0) {
+        // Room for a full event queue per port, so posting never fails
+        m_set = xQueueCreateSet(queues * UART_EVENT_QUEUE_LEN);
+        if (!m_set) ESP_LOGE(TAG, "No RX queue set, polling every %d ms", TUYA_POLL_INTERVAL_MS);
+    }
+    for (int i = 0; i < m_count; i++) {
+        member_t &m = m_members[i];
+        m.in_set = m_set && m.hal->IsEventDriven() && m.hal->JoinQueueSet(m_set) == ESP_OK;
+        if (!m.in_set) {
+            if (m.hal->IsEventDriven()) ESP_LOGE(TAG, "UART%d not in the RX queue set, polling it", (int)m.hal->Port());
+            m_polled_member = true;
+        }
+    }
+    ClearStats(esp_timer_get_time());
+    ESP_LOGI(TAG, "Servicing %d port(s) from one task", m_count);
+
+    // First pass polls everyone: bytes may have arrived before the set existed
+    bool poll_all = true;
+    while (1) {
+        QueueSetMemberHandle_t ready = nullptr;
+        if (!poll_all) {
+            uint32_t wait = WaitMs(idle_timeout_ms);
+            if (m_set) {
+                ready = xQueueSelectFromSet(m_set, ms_to_ticks_ceil(wait));
+            } else {
+                vTaskDelay(ms_to_ticks_ceil(wait));
+            }
+            m_stats.wakeups++;
+        }
+        if (m_reset_requested.exchange(false, std::memory_order_relaxed)) ClearStats(esp_timer_get_time());
+
+        int64_t pass_start = esp_timer_get_time();
+        for (int i = 0; i < m_count; i++) {
+            member_t &m = m_members[i];
+            bool woke = ready && m.hal->EventQueue() == ready;
+            if (woke) m.hal->TakeEvent();
+            // Skip ports that neither raised the event nor have a heartbeat,
+            // retry or handshake step due; polled ports go every pass
+            if (!poll_all && !woke && m.in_set && m.driver->NextWaitMs(1) != 0) continue;
+
+            int64_t start = esp_timer_get_time();
+            m.driver->Poll(0);
+            if (m.after_poll) m.after_poll(m.ctx);
+            uint32_t took = (uint32_t)(esp_timer_get_time() - start);
+
+            tuya_poll_member_stats_t &stats = m_stats.member[i];
+            stats.polls++;
+            stats.busy_us += took;
+            if (took > stats.max_us) stats.max_us = took;
+        }
+        uint32_t pass = (uint32_t)(esp_timer_get_time() - pass_start);
+        m_stats.busy_us += pass;
+        if (pass > m_stats.max_pass_us) m_stats.max_pass_us = pass;
+        for (int i = 0; i < m_count; i++) m_stats.member[i].link = m_members[i].driver->GetLinkState();
+        m_published.Store(m_stats);
+        poll_all = false;
+    }
+}
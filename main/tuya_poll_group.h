@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "tuya_driver.h"
+#include "tuya_hal_esp.h"
+#include "seqlock.h"
+
+// Heaters one RX task can service (one per UART on the ESP32-C6)
+#define TUYA_POLL_GROUP_MAX     3
+
+// Wait cap for ports opened without an event queue (legacy polling)
+#define TUYA_POLL_INTERVAL_MS   50
+
+// Called after each Poll() of that member, on the RX task
+typedef void (*tuya_after_poll_cb_t)(void *ctx);
+
+typedef struct {
+    int port;                   // uart_port_t
+    tuya_link_state_t link;
+    uint32_t polls;
+    uint64_t busy_us;
+    uint32_t max_us;            // Longest single Poll()
+} tuya_poll_member_stats_t;
+
+typedef struct {
+    int members;
+    uint32_t wakeups;           // Returns from the shared wait
+    uint64_t busy_us;           // Time spent servicing, all members
+    uint32_t max_pass_us;       // Longest pass: worst delay one port adds to another
+    int64_t since_us;           // Start of the measurement window
+    tuya_poll_member_stats_t member[TUYA_POLL_GROUP_MAX];
+} tuya_poll_group_stats_t;
+
+// Services several TuyaHeaterDriver instances from one task.
+//
+// The UART event queues of all members go into one FreeRTOS queue set, and
+// the task blocks on it for as long as no driver has a heartbeat, retry or
+// handshake step due. A wake-up only polls the port that raised it plus the
+// ports with timed work due, so the cost of a frame does not grow with the
+// number of heaters. Stats are published once per pass and can be read from
+// any task.
+class TuyaPollGroup {
+public:
+    TuyaPollGroup();
+
+    // Before Run(); the HAL must already be open and the driver initialised
+    esp_err_t Add(TuyaHeaterDriver *driver, EspUartHal *hal, tuya_after_poll_cb_t after_poll = nullptr,
+                  void *ctx = nullptr);
+    int Count() const { return m_count; }
+
+    // Never returns. idle_timeout_ms bounds one wait when nothing is due.
+    void Run(uint32_t idle_timeout_ms);
+
+    tuya_poll_group_stats_t GetStats() const { return m_published.Load(); }
+    // Transmit queue of one member's port; false if there is no such member
+    bool GetTxStats(int index, tuya_tx_stats_t *stats);
+    // Starts a new measurement window (applied by the RX task on its next pass)
+    void ResetStats() { m_reset_requested.store(true, std::memory_order_relaxed); }
+
+private:
+    typedef struct {
+        TuyaHeaterDriver *driver;
+        EspUartHal *hal;
+        tuya_after_poll_cb_t after_poll;
+        void *ctx;
+        bool in_set;            // Woken through the queue set, else polled every pass
+    } member_t;
+
+    member_t m_members[TUYA_POLL_GROUP_MAX];
+    int m_count;
+    bool m_polled_member;       // A member is polled: cap waits at TUYA_POLL_INTERVAL_MS
+    QueueSetHandle_t m_set;
+
+    tuya_poll_group_stats_t m_stats;            // RX task only
+    SeqLock<tuya_poll_group_stats_t> m_published;
+    std::atomic<bool> m_reset_requested;
+
+    uint32_t WaitMs(uint32_t idle_timeout_ms);
+    void ClearStats(int64_t now);
+};
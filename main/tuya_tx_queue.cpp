@@ -0,0 +1,93 @@
+#include "tuya_tx_queue.h"
+#include <string.h>
+
+TuyaTxQueue::TuyaTxQueue() {
+    memset(m_slots, 0, sizeof(m_slots));
+    memset(m_used, 0, sizeof(m_used));
+    m_depth = 0;
+    m_next_order = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+bool TuyaTxQueue::Push(const uint8_t *frame, size_t len, tuya_tx_prio_t prio, int64_t now_us) {
+    if (len == 0 || len > TUYA_TX_FRAME_MAX || prio >= TUYA_TX_PRIO_COUNT) return false;
+    std::lock_guard<std::mutex> lock(m_lock);
+    tuya_tx_class_stats_t &stats = m_stats.prio[prio];
+
+    int free_slot = -1;
+    int victim = -1;    // Newest frame of the least urgent priority below ours
+    for (int i = 0; i < TUYA_TX_QUEUE_LEN; i++) {
+        if (!m_used[i]) {
+            if (free_slot < 0) free_slot = i;
+            continue;
+        }
+        const tuya_tx_frame_t &slot = m_slots[i];
+        // DP writes are never merged here; the command pipeline owns that
+        if (prio != TUYA_TX_PRIO_COMMAND && slot.prio == prio && slot.len == len && memcmp(slot.data, frame, len) == 0) {
+            stats.coalesced++;
+            return true;
+        }
+        if (slot.prio > prio && (victim < 0 || slot.prio > m_slots[victim].prio ||
+                                 (slot.prio == m_slots[victim].prio && (int32_t)(slot.order - m_slots[victim].order) > 0))) {
+            victim = i;
+        }
+    }
+
+    if (free_slot < 0) {
+        if (victim < 0) {
+            stats.dropped++;
+            return false;
+        }
+        m_stats.prio[m_slots[victim].prio].dropped++;
+        m_used[victim] = false;
+        m_depth--;
+        free_slot = victim;
+    }
+
+    tuya_tx_frame_t &slot = m_slots[free_slot];
+    memcpy(slot.data, frame, len);
+    slot.len = (uint8_t)len;
+    slot.prio = (uint8_t)prio;
+    slot.order = m_next_order++;
+    slot.queued_us = now_us;
+    m_used[free_slot] = true;
+    m_depth++;
+    if (m_depth > m_stats.max_depth) m_stats.max_depth = m_depth;
+    stats.queued++;
+    return true;
+}
+
+bool TuyaTxQueue::Pop(tuya_tx_frame_t *out, int64_t now_us) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    int best = -1;
+    for (int i = 0; i < TUYA_TX_QUEUE_LEN; i++) {
+        if (!m_used[i]) continue;
+        if (best < 0 || m_slots[i].prio < m_slots[best].prio ||
+            (m_slots[i].prio == m_slots[best].prio && (int32_t)(m_slots[i].order - m_slots[best].order) < 0)) {
+            best = i;
+        }
+    }
+    if (best < 0) return false;
+
+    *out = m_slots[best];
+    m_used[best] = false;
+    m_depth--;
+
+    tuya_tx_class_stats_t &stats = m_stats.prio[out->prio];
+    uint32_t waited = now_us > out->queued_us ? (uint32_t)(now_us - out->queued_us) : 0;
+    stats.sent++;
+    stats.wait_total_us += waited;
+    if (waited > stats.wait_max_us) stats.wait_max_us = waited;
+    return true;
+}
+
+int TuyaTxQueue::Depth() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_depth;
+}
+
+void TuyaTxQueue::GetStats(tuya_tx_stats_t *stats) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    *stats = m_stats;
+    stats->depth = m_depth;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include "tuya_hal.h"
+
+// Frames waiting for the wire, all priorities together
+#define TUYA_TX_QUEUE_LEN   8
+// Largest frame the driver builds
+#define TUYA_TX_FRAME_MAX   64
+
+typedef struct {
+    uint8_t data[TUYA_TX_FRAME_MAX];
+    uint8_t len;
+    uint8_t prio;               // tuya_tx_prio_t
+    uint32_t order;             // FIFO within a priority
+    int64_t queued_us;
+} tuya_tx_frame_t;
+
+typedef struct {
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t coalesced;         // Identical frame was still waiting
+    uint32_t dropped;           // Queue full, or evicted by a more urgent frame
+    uint32_t wait_max_us;       // Queued -> taken by the writer
+    uint64_t wait_total_us;
+} tuya_tx_class_stats_t;
+
+typedef struct {
+    int depth;
+    int max_depth;
+    tuya_tx_class_stats_t prio[TUYA_TX_PRIO_COUNT];
+} tuya_tx_stats_t;
+
+// Bounded transmit queue of whole frames, most urgent priority first and
+// FIFO within a priority. Fixed slots, no heap.
+//
+// When full, a new frame evicts the newest frame of a less urgent priority,
+// or is dropped itself: a DP write never waits behind a heartbeat. Queries
+// and heartbeats identical to one still waiting are not queued twice. The
+// driver's ack, retry and heartbeat timers recover from anything dropped.
+// Thread-safe: any task may Push(), one writer Pop()s.
+class TuyaTxQueue {
+public:
+    TuyaTxQueue();
+
+    // False if the frame was dropped (too long, or the queue is full of
+    // frames at least as urgent)
+    bool Push(const uint8_t *frame, size_t len, tuya_tx_prio_t prio, int64_t now_us);
+    // Takes the most urgent frame; false if empty
+    bool Pop(tuya_tx_frame_t *out, int64_t now_us);
+
+    int Depth();
+    void GetStats(tuya_tx_stats_t *stats);
+
+private:
+    std::mutex m_lock;
+    tuya_tx_frame_t m_slots[TUYA_TX_QUEUE_LEN];
+    bool m_used[TUYA_TX_QUEUE_LEN];
+    int m_depth;
+    uint32_t m_next_order;
+    tuya_tx_stats_t m_stats;
+};